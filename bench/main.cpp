@@ -0,0 +1,10 @@
+#include <vector>
+#include "osmx/cmd.h"
+
+// osmxBench DIR [OPTIONS] is the same as osmx bench DIR [OPTIONS].
+int main(int argc, char* argv[]) {
+  std::vector<char *> args(argv, argv + argc);
+  char cmd[] = "bench";
+  args.insert(args.begin() + 1, cmd);
+  cmdBench(args.size(), args.data());
+}
@@ -0,0 +1,10 @@
+#include <vector>
+#include "osmx/cmd.h"
+
+// osmxSynthetic OUTPUT_FILE [OPTIONS] is the same as osmx synthetic OUTPUT_FILE [OPTIONS].
+int main(int argc, char* argv[]) {
+  std::vector<char *> args(argv, argv + argc);
+  char cmd[] = "synthetic";
+  args.insert(args.begin() + 1, cmd);
+  cmdSynthetic(args.size(), args.data());
+}
@@ -1,5 +1,6 @@
 #include <vector>
 #include <iomanip>
+#include <cstring>
 #include "osmx/storage.h"
 
 using namespace std;
@@ -19,27 +20,29 @@ int main(int argc, char* argv[]) {
   // Create a Database handle for each element type within the Transaction.
   osmx::db::Locations locations(txn);
   osmx::db::Elements ways(txn,"ways");
+  osmx::db::StringTable strings(txn);
 
   // Fetch a Way element by ID.
   auto message = ways.getReader(stol(args[2]));
   auto way = message.getRoot<Way>();
 
-  // Tags are stored as a vector of key,value.
+  // Tags are stored as a vector of key,value. forEachTag also resolves strings kept in the strings table.
   // Iterate through all tags and print the value if key = name.
-  auto tags = way.getTags();
-  for (int i = 0; i < tags.size() / 2; i++) {
-    if (tags[i*2] == "name") cout << tags[i*2+1].cStr();
-  }
+  osmx::db::forEachTag(strings,way,[](const char *key, const char *value) {
+    if (!strcmp(key,"name")) cout << value;
+  });
 
   // Assemble a WKT LineString geometry.
   cout << "\tLINESTRING (";
   cout << std::fixed << std::setprecision(7); // the output should have 7 decimal places.
-  auto nodes = way.getNodes();
-  for (int i = 0; i < nodes.size(); i++) {
-    auto location = locations.get(nodes[i]);
-    if (i > 0) cout << ",";
+  // forEachNode reads node IDs from either the plain or the packed encoding.
+  bool first = true;
+  osmx::db::forEachNode(way,[&](uint64_t node_id) {
+    auto location = locations.get(node_id);
+    if (!first) cout << ",";
+    first = false;
     cout << location.coords.lon() << " " << location.coords.lat();
-  }
+  });
   cout << ")" << endl;
 
   mdb_env_close(env); // close the database.
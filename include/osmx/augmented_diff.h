@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include "lmdb.h"
+
+namespace osmx {
+
+// writes an augmented diff of the .osc at oscPath to outputPath, in the format of Overpass API augmented diffs:
+// every changed object with its old and new versions, the locations of way nodes and relation members,
+// and the ways and relations whose geometry changes because a node or way in them changed.
+// txn must see the file as it was before the .osc is applied.
+void writeAugmentedDiff(MDB_txn *txn, const std::string &oscPath, const std::string &outputPath);
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "osmium/memory/buffer.hpp"
+#include "osmium/osm/item_type.hpp"
+#include "osmx/storage.h"
+
+namespace osmx {
+
+// appends osmium objects built from the tables of an osmx file to a buffer.
+// each call adds at most one object; the caller commits the buffer.
+class ObjectBuilder {
+  public:
+  ObjectBuilder(MDB_txn *txn, bool includeUserData = true);
+
+  // false if the object is not in the file.
+  bool node(osmium::memory::Buffer &buffer, uint64_t id);
+  bool way(osmium::memory::Buffer &buffer, uint64_t id);
+  bool relation(osmium::memory::Buffer &buffer, uint64_t id);
+
+  // an object with only an id and visible=false, which change files write as a delete.
+  static void deleted(osmium::memory::Buffer &buffer, osmium::item_type type, uint64_t id);
+
+  private:
+  bool mIncludeUserData;
+  db::StringTable mStrings;
+  // objects are usually built in id order, from a bitmap.
+  db::LocationCursor mLocations;
+  db::ElementCursor mNodes;
+  db::ElementCursor mWays;
+  db::ElementCursor mRelations;
+};
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "s2/s2cell_union.h"
+#include "osmx/storage.h"
+
+namespace osmx {
+
+// selects the changed objects that are in the region covered by covering:
+// nodes in the covering or used by a way in it, ways with a node in the covering,
+// relations with a member in either, and all nodes of the selected ways.
+void selectChanges(MDB_txn *txn, const S2CellUnion &covering, const db::ChangeSet &changes, db::ChangeSet &selected);
+
+}
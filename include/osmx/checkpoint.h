@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include "osmx/storage.h"
+
+// the progress of an expand, kept in the metadata table so --resume can continue after a failure.
+// stored as "STAGE ID NAME=RUNS... +NAME...": the last committed element ('n', 'w' or 'r', then 'i' once all are committed),
+// the saved runs of each sort, and the indexes and clustered tables that are finished.
+class Checkpoint {
+  public:
+  Checkpoint() { }
+
+  Checkpoint(const std::string &str) {
+    std::istringstream stream(str);
+    stream >> mStage >> mId;
+    std::string token;
+    while (stream >> token) {
+      if (token[0] == '+') {
+        mFinished.insert(token.substr(1));
+      } else {
+        auto eq = token.find('=');
+        mRuns[token.substr(0,eq)] = std::stoi(token.substr(eq + 1));
+      }
+    }
+  }
+
+  bool empty() const {
+    return mStage == 0;
+  }
+
+  // true if the element was committed before the checkpoint.
+  bool skip(char type, uint64_t id) const {
+    return order(type) < order(mStage) || (type == mStage && id <= mId);
+  }
+
+  // the last committed id of type: all ids of earlier types, none of later ones.
+  uint64_t committed(char type) const {
+    if (order(type) < order(mStage)) return UINT64_MAX;
+    return type == mStage ? mId : 0;
+  }
+
+  bool elementsDone() const {
+    return mStage == 'i';
+  }
+
+  void set(char stage, uint64_t id) {
+    mStage = stage;
+    mId = id;
+  }
+
+  int runs(const std::string &name) const {
+    auto it = mRuns.find(name);
+    return it == mRuns.end() ? 0 : it->second;
+  }
+
+  void setRuns(const std::string &name, int runs) {
+    mRuns[name] = runs;
+  }
+
+  bool finished(const std::string &name) const {
+    return mFinished.count(name) > 0;
+  }
+
+  void finish(const std::string &name) {
+    mFinished.insert(name);
+  }
+
+  std::string str() const {
+    std::ostringstream stream;
+    stream << mStage << " " << mId;
+    for (auto const &run : mRuns) stream << " " << run.first << "=" << run.second;
+    for (auto const &name : mFinished) stream << " +" << name;
+    return stream.str();
+  }
+
+  void save(MDB_txn *txn) const {
+    osmx::db::Metadata(txn).put("expand_checkpoint",str());
+  }
+
+  private:
+  static int order(char stage) {
+    switch (stage) {
+      case 'n': return 1;
+      case 'w': return 2;
+      case 'r': return 3;
+      case 'i': return 4;
+      default: return 0;
+    }
+  }
+
+  char mStage = 0;
+  uint64_t mId = 0;
+  std::map<std::string,int> mRuns;
+  std::set<std::string> mFinished;
+};
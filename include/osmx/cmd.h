@@ -1,3 +1,11 @@
 void cmdExpand(int argc, char* argv[]);
 void cmdExtract(int argc, char* argv[]);
 void cmdUpdate(int argc, char* argv[]);
+void cmdChanges(int argc, char* argv[]);
+void cmdAugmentedDiff(int argc, char* argv[]);
+void cmdExport(int argc, char* argv[]);
+void cmdSnapshot(int argc, char* argv[]);
+void cmdStat(int argc, char* argv[]);
+void cmdCompact(int argc, char* argv[]);
+void cmdBench(int argc, char* argv[]);
+void cmdSynthetic(int argc, char* argv[]);
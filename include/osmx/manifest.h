@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "s2/s2cell_union.h"
+
+namespace osmx {
+
+// a set of regional .osmx files, each a complete extract of its region that is updated on its own.
+// the manifest is JSON: {"shards":[{"osmx":"europe.osmx","region":"europe.json"},...]}
+// with paths relative to the manifest.
+class Manifest {
+  public:
+  struct Shard {
+    std::string osmx;
+    std::string region;
+    S2CellUnion covering;
+  };
+
+  Manifest(const std::string &path);
+
+  // the smallest shard whose covering contains all of covering, or null if none does.
+  const Shard *route(const S2CellUnion &covering) const;
+
+  const std::vector<Shard> &shards() const { return mShards; }
+
+  private:
+  std::vector<Shard> mShards;
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "lmdb.h"
+#include "nlohmann/json.hpp"
+
+namespace osmx {
+
+// counters, histograms and phase timings for one command,
+// written as JSON or Prometheus text when the command finishes.
+class Metrics {
+  public:
+  Metrics(const std::string &command) : mCommand(command) { }
+
+  void add(const std::string &counter, uint64_t value = 1) {
+    mCounters[counter] += value;
+  }
+
+  // histograms have power of two buckets: a value v is counted in the first bucket with v <= 2^i.
+  void observe(const std::string &histogram, uint64_t value);
+
+  void phase(const std::string &name, double seconds, uint64_t majorFaults);
+
+  // page counts of the environment and of every table, from mdb_env_info and mdb_stat.
+  void lmdb(MDB_env *env, MDB_txn *txn);
+
+  nlohmann::json json() const;
+  std::string prometheus() const;
+
+  // writes Prometheus text if path ends in .prom, otherwise JSON. "-" is stdout.
+  void write(const std::string &path) const;
+
+  private:
+  struct Histogram {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(65);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+  };
+
+  struct PhaseTiming {
+    double seconds = 0;
+    uint64_t majorFaults = 0;
+  };
+
+  std::string mCommand;
+  std::map<std::string,uint64_t> mCounters;
+  std::map<std::string,Histogram> mHistograms;
+  // phases in the order they ran.
+  std::vector<std::pair<std::string,PhaseTiming>> mPhases;
+  std::map<std::string,MDB_stat> mTables;
+  MDB_envinfo mEnvInfo{};
+  MDB_stat mEnvStat{};
+  bool mHasLmdb = false;
+};
+
+// adds the time between construction and destruction to a phase.
+// major page faults are counted too: LMDB reads through a memory map, so these are the pages read from disk.
+class Phase {
+  public:
+  Phase(Metrics &metrics, const std::string &name);
+  ~Phase();
+
+  private:
+  Metrics &mMetrics;
+  std::string mName;
+  std::chrono::high_resolution_clock::time_point mStartTime;
+  uint64_t mStartFaults;
+};
+
+}
@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include "s2/s2region.h"
 #include "s2/s2cell_union.h"
 #include "s2/s2region_coverer.h"
@@ -8,6 +9,8 @@
 class Region {
 public:
 	Region(const std::string &text, const std::string &ext);
+	// reads a file with extension .bbox, .disc, .json or .poly. null for other extensions.
+	static std::unique_ptr<Region> FromFile(const std::string &fname);
 	bool Contains(S2Point p);
 	S2CellUnion GetCovering(S2RegionCoverer &coverer);
 	S2LatLngRect GetBounds();
@@ -16,4 +19,15 @@ private:
 	void AddS2RegionFromGeometry(nlohmann::json &geometry);
 	void AddS2RegionFromPolyFile(std::istringstream &file);
 	std::vector<std::unique_ptr<S2Region>> mRegions;
-};
\ No newline at end of file
+};
+
+// a range of cell ids, and the regions whose coverings contain all of it.
+struct BatchRange {
+	uint64_t start;
+	uint64_t end;
+	std::vector<size_t> regions;
+};
+
+// splits the coverings of all regions into ranges where the same set of regions overlap,
+// so each part of cell_node is read once no matter how many regions contain it.
+std::vector<BatchRange> batchRanges(const std::vector<S2CellUnion> &coverings);
@@ -0,0 +1,208 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include "osmium/util/file.hpp"
+#include "osmium/util/progress_bar.hpp"
+#include "osmx/storage.h"
+
+// an external sort of (from,to) pairs, spilled to runs in tempDir, used to build the index tables.
+
+typedef std::pair<uint64_t, uint64_t> Pair; 
+typedef std::pair<Pair, uint64_t> pqelem;
+
+class SortReader {
+  public:
+  SortReader(std::string filename) : mStream(filename, std::ios::in | std::ios::binary), mName(filename) {
+    if (!mStream) {
+      perror(filename.c_str());
+      exit(1);
+    }
+  }
+
+  // false at the end of the run. a run that can't be read is an error, so the merge never reads garbage.
+  bool getNext() {
+    mStream.read((char *)&entry,sizeof(uint64_t) *2);
+    if (mStream) return true;
+    if (mStream.eof() && mStream.gcount() == 0) return false;
+    std::cerr << "Failed to read sort run " << mName << std::endl;
+    exit(1);
+  }
+
+  Pair entry;
+
+  private:
+  std::ifstream mStream;
+  std::string mName;
+};
+
+class Sorter {
+int MAX_RUN_SIZE = 64000000; // about 1 GB
+// runs merged at once, below the usual limit of 1024 open files.
+// with more runs, groups of runs are merged into intermediate runs first.
+size_t MAX_MERGE_RUNS = 256;
+public:
+  Sorter(std::string tempDir,std::string name) : mTempDir(tempDir), mName(name) { 
+    mStorage.reserve(MAX_RUN_SIZE);
+  }
+
+  // resumes from the first `runs` saved runs of an interrupted sort.
+  // later runs were written after the last checkpoint and are discarded.
+  Sorter(std::string tempDir,std::string name,int runs) : Sorter(tempDir,name) {
+    for (int i = 0; i < runs; i++) mSavedRuns.push_back(runName(i));
+    for (int i = runs; std::remove(runName(i).c_str()) == 0; i++) { }
+  }
+
+  int runs() const {
+    return mSavedRuns.size();
+  }
+
+  const std::string &name() const {
+    return mName;
+  }
+
+  void put(uint64_t from, uint64_t to) {
+    mStorage.push_back(std::make_pair(from,to));
+    if (mStorage.size() > MAX_RUN_SIZE) persist();
+  }
+
+  void put(S2CellId from, uint64_t to) {
+    put(from.id(),to);
+  }
+
+  void persist() {
+    if (mStorage.size() == 0) return;
+    std::sort(mStorage.begin(),mStorage.end());
+    std::string fname = runName(mSavedRuns.size());
+    std::ofstream stream;
+    stream.open(fname,std::ios::binary);
+    for (auto const &entry: mStorage) {
+      stream.write((char *)&entry.first,sizeof(uint64_t));
+      stream.write((char *)&entry.second,sizeof(uint64_t));
+    }
+    stream.close();
+    if (!stream) {
+      perror(fname.c_str());
+      exit(1);
+    }
+    mStorage.clear();
+    mStorage.reserve(MAX_RUN_SIZE);
+    mSavedRuns.push_back(fname);
+  }
+
+  void writeDb(MDB_env *env) {
+    osmx::db::IndexWriter index(env,mName);
+    Pair last;
+    mergeRuns([&](uint64_t from, uint64_t to) {
+      Pair entry = std::make_pair(from,to);
+      if (entry != last) {
+        if (from != last.first) index.put(from,to,MDB_APPEND);
+        else index.put(from,to,MDB_APPENDDUP);
+      }
+      last = entry;
+    });
+    index.commit();
+  }
+
+  // calls fn(from,to) for every pair in sorted order.
+  template <typename F>
+  void merge(F fn) {
+    mergeRuns(fn);
+    removeRuns();
+  }
+
+  // the runs are kept by writeDb, so an interrupted expand can write the index again.
+  void removeRuns() {
+    for (auto const &run : mSavedRuns) {
+      std::remove(run.c_str());
+    }
+    mSavedRuns.clear();
+  }
+
+private:
+  std::string runName(int runNumber) const {
+    std::stringstream fname;
+    fname << mTempDir << "/" << std::setw(2) << std::setfill('0') << mName << "_" << std::setw(3) << std::setfill('0') << runNumber << ".run";
+    return fname.str();
+  }
+
+  std::string stageName(int stage, int runNumber) const {
+    std::stringstream fname;
+    fname << mTempDir << "/" << mName << "_s" << stage << "_" << std::setw(3) << std::setfill('0') << runNumber << ".run";
+    return fname.str();
+  }
+
+  // the saved runs are left in place, and the intermediate runs are removed.
+  template <typename F>
+  void mergeRuns(F fn) {
+    persist();
+
+    Timer timer("External sort " + mName);
+    std::vector<std::string> runs = mSavedRuns;
+    std::vector<std::string> intermediate;
+    for (int stage = 0; runs.size() > MAX_MERGE_RUNS; stage++) {
+      std::vector<std::string> merged;
+      for (size_t i = 0; i < runs.size(); i += MAX_MERGE_RUNS) {
+        std::vector<std::string> group(runs.begin() + i,runs.begin() + std::min(i + MAX_MERGE_RUNS,runs.size()));
+        std::string fname = stageName(stage,merged.size());
+        std::ofstream stream(fname,std::ios::binary);
+        mergeFiles(group,[&](uint64_t from, uint64_t to) {
+          stream.write((char *)&from,sizeof(uint64_t));
+          stream.write((char *)&to,sizeof(uint64_t));
+        });
+        stream.close();
+        if (!stream) {
+          perror(fname.c_str());
+          exit(1);
+        }
+        merged.push_back(fname);
+      }
+      for (auto const &run : intermediate) std::remove(run.c_str());
+      intermediate = merged;
+      runs = merged;
+    }
+
+    // runs of checkpoints are smaller than MAX_RUN_SIZE, so the total is counted from the files.
+    size_t total = 0;
+    for (auto const &run : mSavedRuns) total += osmium::file_size(run) / (sizeof(uint64_t) * 2);
+    osmium::ProgressBar progress{total, osmium::isatty(2) && !quiet()};
+    int read = 0;
+    mergeFiles(runs,[&](uint64_t from, uint64_t to) {
+      fn(from,to);
+      progress.update(read++);
+    });
+    progress.done();
+    for (auto const &run : intermediate) std::remove(run.c_str());
+  }
+
+  template <typename F>
+  void mergeFiles(const std::vector<std::string> &files, F fn) {
+    std::priority_queue<pqelem, std::vector<pqelem>, std::greater<pqelem>> q;
+    std::vector<SortReader> readers;
+
+    for (size_t i = 0; i < files.size(); i++) {
+      readers.emplace_back(files[i]);  
+      if (readers[i].getNext()) q.push(std::make_pair(readers[i].entry, i));
+    }
+
+    while (q.size() > 0) {
+      pqelem pair = q.top();
+      auto idx = pair.second;
+      fn(pair.first.first,pair.first.second);
+      q.pop();
+      if (readers[idx].getNext()) q.push(std::make_pair(readers[idx].entry, idx));
+    }
+  }
+
+  Sorter( const Sorter& ) = delete;
+  Sorter& operator=( const Sorter& ) = delete;
+  std::vector<std::pair<uint64_t,uint64_t>> mStorage;
+  std::vector<std::string> mSavedRuns;
+  std::string mTempDir;
+  std::string mName;
+};
@@ -1,9 +1,16 @@
 #pragma once
+#include <cstring>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include "lmdb.h"
 #include "osmium/osm/location.hpp"
+#include "osmium/osm/way.hpp"
 #include "kj/io.h"
 #include "capnp/message.h"
 #include "capnp/serialize.h"
+#include "capnp/serialize-packed.h"
 #include "osmx/messages.capnp.h"
 #include "osmx/util.h"
 #include "s2/s2cell_id.h"
@@ -14,7 +21,11 @@ namespace osmx { namespace db {
 
 uint64_t to64(osmium::Location loc);
 osmium::Location toLoc(uint64_t val);
-MDB_env *createEnv(std::string path, bool writable = false);
+// flags are added to the environment flags, such as MDB_WRITEMAP for bulk loading.
+MDB_env *createEnv(std::string path, bool writable = false, int flags = 0);
+// a writable environment held in memory, for tests and small regions served at low latency.
+// it starts as a copy of the .osmx file source, or empty, and is freed when it is closed.
+MDB_env *createMemoryEnv(const std::string &source = "");
 
 class Noncopyable {
   public:
@@ -23,6 +34,41 @@ class Noncopyable {
   Noncopyable& operator=( const Noncopyable& ) = delete;
 };
 
+// an environment that is closed when it goes out of scope.
+// commands open their files through Env and Txn instead of calling mdb_env and mdb_txn functions,
+// and pass them where an MDB_env * or MDB_txn * is expected.
+class Env : public Noncopyable {
+  public:
+  Env(const std::string &path, bool writable = false, int flags = 0) : mEnv(createEnv(path,writable,flags)) { }
+  // takes ownership of env, such as one from createMemoryEnv.
+  explicit Env(MDB_env *env) : mEnv(env) { }
+  ~Env();
+  operator MDB_env *() const { return mEnv; }
+  // files are opened with MDB_NOSYNC, so writers sync once at the end.
+  void sync();
+
+  private:
+  MDB_env *mEnv;
+};
+
+// a txn that is aborted when it goes out of scope, unless it was committed.
+// Txn must go out of scope before its Env, and cursors opened in it before it is committed.
+class Txn : public Noncopyable {
+  public:
+  Txn(MDB_env *env, bool writable = false);
+  ~Txn();
+  operator MDB_txn *() const { return mTxn; }
+  void commit();
+  void abort();
+  // commits a write txn and begins the next one, for writes too large for one txn.
+  // tables opened with the old txn must be given the new one with setTxn.
+  void restart();
+
+  private:
+  MDB_env *mEnv;
+  MDB_txn *mTxn;
+};
+
 class Metadata : public Noncopyable {
   public:
   Metadata(MDB_txn *txn);
@@ -34,19 +80,213 @@ class Metadata : public Noncopyable {
   MDB_dbi mDbi;
 };
 
+// the most frequent tag keys, tag values and user names, stored once.
+// elements refer to an entry by its code, which starts at 1.
+// an empty table means that all strings are stored inline.
+// strings are read from the table as they are used, so opening it is cheap;
+// code() reads the whole table the first time it is called.
+class StringTable : public Noncopyable {
+  public:
+  StringTable(MDB_txn *txn);
+  static void create(MDB_txn *txn, const std::vector<std::string> &strings);
+  void setTxn(MDB_txn *txn) { mTxn = txn; }
+  bool empty() const { return mSize == 0; }
+  size_t size() const { return mSize; }
+  const char *get(uint32_t code) const;
+
+  // 0 if the string is not in the table.
+  uint32_t code(const char *str) const;
+
+  private:
+  struct Hash {
+    size_t operator()(const char *str) const {
+      // FNV-1a
+      size_t h = 14695981039346656037ULL;
+      for (; *str; str++) h = (h ^ (unsigned char)*str) * 1099511628211ULL;
+      return h;
+    }
+  };
+  struct Equal {
+    bool operator()(const char *a, const char *b) const { return strcmp(a,b) == 0; }
+  };
+
+  MDB_txn *mTxn;
+  MDB_dbi mDbi;
+  size_t mSize = 0;
+  // by code. the strings don't move once added, so mCodes points into them.
+  mutable std::unordered_map<uint32_t,std::string> mStrings;
+  mutable std::unordered_map<const char *,uint32_t,Hash,Equal> mCodes;
+};
+
+// calls fn(key,value) for each tag of a Node, Way or Relation reader.
+template <typename R, typename F>
+void forEachTag(const StringTable &strings, R reader, F fn) {
+  auto tags = reader.getTags();
+  if (!reader.hasTagCodes()) {
+    for (unsigned int i = 0; i < tags.size() / 2; i++) {
+      fn(tags[i*2].cStr(),tags[i*2+1].cStr());
+    }
+    return;
+  }
+
+  auto codes = reader.getTagCodes();
+  unsigned int literal = 0;
+  for (unsigned int i = 0; i < codes.size() / 2; i++) {
+    const char *key = codes[i*2] ? strings.get(codes[i*2]) : tags[literal++].cStr();
+    const char *value = codes[i*2+1] ? strings.get(codes[i*2+1]) : tags[literal++].cStr();
+    fn(key,value);
+  }
+}
+
+inline const char *getUser(const StringTable &strings, ::Metadata::Reader metadata) {
+  if (metadata.getUserCode()) return strings.get(metadata.getUserCode());
+  return metadata.getUser().cStr();
+}
+
+template <typename T>
+void setTags(const osmium::TagList &tags, T &builder, const StringTable &strings) {
+  if (strings.empty() || tags.size() == 0) {
+    ::setTags<T>(tags,builder);
+    return;
+  }
+
+  auto codes = builder.initTagCodes(tags.size() * 2);
+  int literals = 0;
+  int i = 0;
+  for (auto const &tag : tags) {
+    codes.set(i,strings.code(tag.key()));
+    if (codes[i++] == 0) literals++;
+    codes.set(i,strings.code(tag.value()));
+    if (codes[i++] == 0) literals++;
+  }
+  if (literals == 0) return;
+
+  auto tagBuilder = builder.initTags(literals);
+  int literal = 0;
+  i = 0;
+  for (auto const &tag : tags) {
+    if (codes[i++] == 0) tagBuilder.set(literal++,tag.key());
+    if (codes[i++] == 0) tagBuilder.set(literal++,tag.value());
+  }
+}
+
+inline void setUser(::Metadata::Builder metadata, const char *user, const StringTable &strings) {
+  uint32_t code = strings.code(user);
+  if (code) metadata.setUserCode(code);
+  else metadata.setUser(user);
+}
+
+// writes the node ids of a way, optionally packed into packedNodes as zigzag varint deltas.
+void setNodes(Way::Builder way, const osmium::WayNodeList &nodes, bool packed);
+
+// calls fn(node_id) for each node of a Way reader, in order.
+template <typename F>
+void forEachNode(Way::Reader way, F fn) {
+  if (!way.hasPackedNodes()) {
+    for (auto node_id : way.getNodes()) fn(node_id);
+    return;
+  }
+
+  auto packed = way.getPackedNodes();
+  const kj::byte *p = packed.begin();
+  const kj::byte *end = packed.end();
+  uint64_t node_id = 0;
+  while (p < end) {
+    uint64_t v = *p++;
+    // most deltas fit in one byte, so only loop for the rest.
+    // a varint cut off by the end of the data, or longer than 10 bytes, ends the list.
+    if (v & 0x80) {
+      v &= 0x7f;
+      int shift = 7;
+      uint64_t b;
+      do {
+        if (p == end || shift >= 64) return;
+        b = *p++;
+        v |= (b & 0x7f) << shift;
+        shift += 7;
+      } while (b & 0x80);
+    }
+    node_id += (v >> 1) ^ (~(v & 1) + 1);
+    fn(node_id);
+  }
+}
+
+// a packed message and the stream it is unpacked from, which the reader reads lazily.
+struct PackedElement {
+  PackedElement(kj::ArrayPtr<const kj::byte> bytes) : mInput(bytes), mReader(mInput) { }
+  kj::ArrayInputStream mInput;
+  capnp::PackedMessageReader mReader;
+};
+
+// a message read from an Elements table.
+// it points directly into the mmapped page and is valid until the txn ends,
+// unless the table is packed, in which case it owns the unpacked message.
+// both readers check the segment table against the size of the value.
+class ElementReader {
+  public:
+  ElementReader(kj::ArrayPtr<const capnp::word> words) : mFlat(words) { }
+  ElementReader(kj::ArrayPtr<const kj::byte> packed) : mFlat(nullptr), mPacked(kj::heap<PackedElement>(packed)) { }
+  ElementReader(ElementReader &&other) = default;
+
+  template <typename T>
+  typename T::Reader getRoot() {
+    if (mPacked != nullptr) return mPacked->mReader.getRoot<T>();
+    return mFlat.getRoot<T>();
+  }
+
+  private:
+  capnp::FlatArrayMessageReader mFlat;
+  kj::Own<PackedElement> mPacked;
+};
+
 class Elements : public Noncopyable {
   public:
   Elements(MDB_txn *txn, const std::string &name);
+  // continues in a new txn after the previous one was committed; table handles stay valid.
+  void setTxn(MDB_txn *txn) { mTxn = txn; }
   void put(uint64_t id, kj::VectorOutputStream &vos, int flags = 0);
   void del(uint64_t id);
   bool exists(uint64_t id);
-  capnp::FlatArrayMessageReader getReader(uint64_t id);
+  // deletes the elements with ids above after. the table must not be clustered.
+  void truncate(uint64_t after);
+  ElementReader getReader(uint64_t id);
+
+  // a single lookup that is empty if the id is not present.
+  kj::Maybe<ElementReader> tryGet(uint64_t id);
+
+  protected:
+  bool find(uint64_t id, uint64_t &position);
+  ElementReader read(const MDB_val &data);
 
-  private:
   MDB_txn *mTxn;
   MDB_dbi mDbi;
+  // values are capnp packed if the file was expanded with --compress.
+  bool mPacked;
+  // clustered tables keep values in NAME_clustered under a position, found through NAME_position.
+  bool mClustered = false;
+  MDB_dbi mPositions;
+  // set by ElementCursor.
+  MDB_cursor *mCursor = nullptr;
+  MDB_cursor *mPositionCursor = nullptr;
+};
+
+// Elements read through cursors, which is faster when ids are looked up in increasing order, like those of a bitmap:
+// each lookup first searches the page of the previous one.
+// in a write txn, it must be destroyed before the txn is committed.
+class ElementCursor : public Elements {
+  public:
+  ElementCursor(MDB_txn *txn, const std::string &name);
+  ~ElementCursor();
+  // the next id in the table, from the first; a lookup moves the cursor too.
+  bool next(uint64_t &id);
 };
 
+// the position of an element in a clustered table: the level 13 cell in the top 29 bits, the id in the lower 35.
+// elements without a known cell are positioned by id alone.
+// a larger id would overlap the cell bits and could collide with another position, so it is an error.
+const uint64_t CLUSTER_MAX_ID = 1ULL << 35;
+uint64_t clusterPosition(S2CellId cell, uint64_t id);
+
 class Location {
   public:
   Location() { };
@@ -68,14 +308,48 @@ class Location {
 class Locations : public Noncopyable {
   public:
   Locations(MDB_txn *txn);
+  void setTxn(MDB_txn *txn) { mTxn = txn; }
   void put(uint64_t id, const Location value, int flags = 0);
   void del(uint64_t id);
   bool exists(uint64_t id);
   Location get(uint64_t id) const;
+  // deletes the locations of ids above after.
+  void truncate(uint64_t after);
 
-  private:
+  protected:
   MDB_txn* mTxn;
   MDB_dbi mDbi;
+  // set by LocationCursor.
+  MDB_cursor *mCursor = nullptr;
+};
+
+// Locations read through a cursor, like ElementCursor.
+class LocationCursor : public Locations {
+  public:
+  LocationCursor(MDB_txn *txn);
+  ~LocationCursor();
+  // the next location in the table, from the first; a lookup moves the cursor too.
+  bool next(uint64_t &id, Location &location);
+};
+
+// writes an element table in clustered form, for expand --cluster:
+// NAME_position from each id to its position, and the values of NAME copied to NAME_clustered by position.
+// in a write txn, it must be destroyed before the txn is committed.
+class ClusterWriter : public Noncopyable {
+  public:
+  ClusterWriter(MDB_txn *txn, const std::string &name);
+  // in increasing order of id.
+  void putPosition(uint64_t id, uint64_t position);
+  // in increasing order of position.
+  void copy(uint64_t position, uint64_t id);
+  // empties NAME once every value is copied.
+  void dropSource();
+
+  private:
+  MDB_txn *mTxn;
+  MDB_dbi mSource;
+  MDB_dbi mPositions;
+  MDB_dbi mClustered;
 };
 
 class Index : public Noncopyable {
@@ -89,6 +363,99 @@ class Index : public Noncopyable {
   MDB_txn *mTxn;
 };
 
+// the number of nodes in each cell at CELL_COUNT_LEVEL, for estimating the size of an extract without reading node ids.
+// files expanded before this table existed don't have it, and present() is false.
+class CellCounts : public Noncopyable {
+  public:
+  CellCounts(MDB_txn *txn);
+  static void create(MDB_txn *txn, const std::unordered_map<uint64_t,uint64_t> &counts);
+  bool present() const { return mPresent; }
+  void add(S2CellId cell, int64_t delta);
+
+  // the number of nodes in a cell at CELL_COUNT_LEVEL or above.
+  uint64_t count(S2CellId cell);
+
+  private:
+  MDB_txn *mTxn;
+  MDB_dbi mDbi;
+  bool mPresent;
+};
+
+// the ids of the nodes, ways and relations changed by one or more sequences of updates.
+struct ChangeSet {
+  Roaring64Map nodes;
+  Roaring64Map ways;
+  Roaring64Map relations;
+};
+
+// maps the sequence number of each applied update to the ids it changed.
+// the table is created by the first update with --changelog and then kept by every update.
+class Changelog : public Noncopyable {
+  public:
+  Changelog(MDB_txn *txn, bool create = false);
+  bool present() const { return mPresent; }
+  void put(uint64_t seqnum, ChangeSet &changes);
+
+  // adds the changes of the sequences after from, up to and including to.
+  // returns the number of sequences found.
+  uint64_t get(uint64_t from, uint64_t to, ChangeSet &changes);
+
+  private:
+  MDB_txn *mTxn;
+  MDB_dbi mDbi;
+  bool mPresent;
+};
+
+const uint64_t TAG_INDEX_BLOCK = 1ULL << 24;
+
+// the ids of the nodes, ways and relations with each tag, for the keys chosen with expand --tag-index.
+// table keys are "n/KEY=VALUE", "w/KEY=VALUE" or "r/KEY=VALUE", a zero byte and the id block, and values are bitmaps of ids.
+// each block holds TAG_INDEX_BLOCK ids, so updates and queries read and write bounded bitmaps even for common tags.
+// the indexed keys are in the metadata table, so updates keep indexing the same keys.
+// changes are buffered in memory and merged into the stored bitmaps by flush().
+class TagIndex : public Noncopyable {
+  public:
+  TagIndex(MDB_txn *txn);
+  static void create(MDB_txn *txn, const std::vector<std::string> &keys);
+  bool present() const { return mPresent; }
+  bool indexes(const std::string &key) const { return mKeys.count(key) > 0; }
+  // buffered changes are kept, and written by the next flush().
+  void setTxn(MDB_txn *txn) { mTxn = txn; }
+
+  void add(osmium::item_type type, const char *key, const char *value, uint64_t id);
+  void add(osmium::item_type type, const osmium::TagList &tags, uint64_t id);
+  void remove(osmium::item_type type, const char *key, const char *value, uint64_t id);
+
+  // removes the stored tags of a Node, Way or Relation reader.
+  template <typename R>
+  void remove(const StringTable &strings, osmium::item_type type, R reader, uint64_t id) {
+    forEachTag(strings,reader,[&](const char *key, const char *value) {
+      remove(type,key,value,id);
+    });
+  }
+
+  void flush();
+  // the number of ids added or removed since the last flush().
+  uint64_t buffered() const { return mBuffered; }
+
+  // adds the ids in within of objects of type with key=value, or with key and any value if anyValue.
+  // only the blocks with ids in within are read.
+  void get(osmium::item_type type, const std::string &key, bool anyValue, const std::string &value, const Roaring64Map &within, Roaring64Map &ids);
+
+  private:
+  std::string valueKey(osmium::item_type type, const std::string &key, const std::string &value) const;
+  static std::string tableKey(const std::string &valueKey, uint64_t id);
+
+  MDB_txn *mTxn;
+  MDB_dbi mDbi;
+  bool mPresent;
+  size_t mMaxKeySize;
+  uint64_t mBuffered = 0;
+  std::set<std::string> mKeys;
+  std::map<std::string,Roaring64Map> mAdded;
+  std::map<std::string,Roaring64Map> mRemoved;
+};
+
 class IndexWriter : public Noncopyable {
   public:
   IndexWriter(MDB_env *env, const std::string &name);
@@ -96,14 +463,40 @@ class IndexWriter : public Noncopyable {
   void commit();
 
   private:
-  MDB_env *mEnv;
+  Txn mTxn;
   MDB_dbi mDbi;
-  MDB_txn *mTxn;
   std::string mName;
   int mWrites = 0;
 };
 
 void traverseCell(MDB_cursor *cursor,S2CellId cell_id,Roaring64Map &set);
+// adds the node ids of cell_node keys from start up to but not including end.
+void traverseRange(MDB_cursor *cursor,uint64_t start,uint64_t end,Roaring64Map &set);
 void traverseReverse(MDB_cursor *cursor,uint64_t from, Roaring64Map &set);
 
+// the number of node ids in a cell of cell_node, counted per key instead of read.
+uint64_t countCell(MDB_cursor *cursor,S2CellId cell_id);
+
+// a read cursor on an index table such as cell_node or node_way, so callers don't open dbis and cursors themselves.
+// in a write txn, it must be destroyed before the txn is committed.
+class IndexCursor : public Noncopyable {
+  public:
+  IndexCursor(MDB_txn *txn, const std::string &name);
+  ~IndexCursor();
+  void traverseCell(S2CellId cell_id, Roaring64Map &set) { db::traverseCell(mCursor,cell_id,set); }
+  void traverseRange(uint64_t start, uint64_t end, Roaring64Map &set) { db::traverseRange(mCursor,start,end,set); }
+  void traverseReverse(uint64_t from, Roaring64Map &set) { db::traverseReverse(mCursor,from,set); }
+  uint64_t countCell(S2CellId cell_id) { return db::countCell(mCursor,cell_id); }
+
+  private:
+  MDB_cursor *mCursor;
+};
+
+// the names of the tables in the file, which are the keys of the main DB.
+std::vector<std::string> tableNames(MDB_txn *txn);
+
+// the number of entries in an element table, or 0 if it doesn't exist.
+// clustered element tables are counted by their positions.
+uint64_t tableEntries(MDB_txn *txn, const std::string &table);
+
 } }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include "osmium/osm/box.hpp"
+
+// parameters of a generated dataset. the same options always produce the same files.
+struct SyntheticOptions {
+  uint64_t nodes = 1000000;
+  uint64_t seed = 0;
+  osmium::Box bounds{-74.3,40.5,-73.7,40.9};
+  // nodes are placed around this many centers, with the first centers much denser than the rest.
+  int clusters = 100;
+  // the mean number of nodes of a way that is not a building.
+  double wayLength = 10;
+  // the mean difference between consecutive ids, because deleted elements leave gaps.
+  double idGap = 1.2;
+  // relations of ways, relations of those relations, and so on.
+  int relationDepth = 3;
+  // the fraction of elements a change file modifies; a quarter as many are deleted and a tenth as many created.
+  double changeFraction = 0.01;
+};
+
+struct SyntheticStats {
+  uint64_t nodes = 0;
+  uint64_t ways = 0;
+  uint64_t relations = 0;
+  uint64_t maxNodeId = 0;
+  uint64_t maxWayId = 0;
+  uint64_t maxRelationId = 0;
+};
+
+// writes the dataset to an .osm.pbf or .osm file.
+SyntheticStats writeSynthetic(const std::string &path, const SyntheticOptions &options);
+
+// writes an .osc that changes the dataset generated with the same options.
+SyntheticStats writeSyntheticChange(const std::string &path, const SyntheticOptions &options);
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "osmium/osm/item_type.hpp"
+#include "osmx/storage.h"
+
+namespace osmx {
+
+// tag expressions like those of osmium tags-filter: [TYPES/]KEY[=VALUE], where TYPES is any of n, w and r.
+// without TYPES an expression applies to all three; without VALUE any value matches.
+// an object matches if any expression for its type matches one of its tags.
+class TagFilter {
+  public:
+  // false if the expression is malformed.
+  bool add(const std::string &expression);
+  bool empty() const { return mExpressions.empty(); }
+
+  // true if some expression applies to objects of this type.
+  bool filters(osmium::item_type type) const;
+
+  bool matches(osmium::item_type type, const char *key, const char *value) const;
+
+  // adds the ids in within of all objects of type matching the filter from the tag index.
+  // false if the index does not have every key the filter uses for type.
+  bool lookup(db::TagIndex &index, osmium::item_type type, const Roaring64Map &within, Roaring64Map &ids) const;
+
+  // evaluated on the stored tags of a Node, Way or Relation reader, without building an osmium object.
+  template <typename R>
+  bool matches(const db::StringTable &strings, osmium::item_type type, R reader) const {
+    bool found = false;
+    db::forEachTag(strings,reader,[&](const char *key, const char *value) {
+      if (!found && matches(type,key,value)) found = true;
+    });
+    return found;
+  }
+
+  private:
+  struct Expression {
+    bool node;
+    bool way;
+    bool relation;
+    std::string key;
+    bool anyValue;
+    std::string value;
+  };
+  std::vector<Expression> mExpressions;
+};
+
+}
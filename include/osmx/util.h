@@ -8,16 +8,32 @@
 // a higher cell level results in more precise extracts, as the size of 1 cell is the minimum index resolution.
 #define CELL_INDEX_LEVEL 16
 
+// the level of the cell_count table. a level 10 cell is around 100 square kilometers.
+#define CELL_COUNT_LEVEL 10
+
+// set by the --quiet option of expand, extract and update.
+inline bool &quiet() {
+  static bool q = false;
+  return q;
+}
+
+// progress messages go here instead of cout, so --quiet turns them off. errors are printed to cout either way.
+inline std::ostream &progress() {
+  // a stream without a buffer discards everything written to it.
+  static std::ostream null(nullptr);
+  return quiet() ? null : std::cout;
+}
+
 class Timer {
   public:
   Timer(std::string name) : mName(name) {
     mStartTime = std::chrono::high_resolution_clock::now();
-    std::cout << "Start " << mName << std::endl;
+    progress() << "Start " << mName << std::endl;
   }
 
   ~Timer() {
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - mStartTime ).count();
-    std::cout << "Finished " << mName << " in " << duration/1000.0 << " seconds." << std::endl;
+    progress() << "Finished " << mName << " in " << duration/1000.0 << " seconds." << std::endl;
   }
 
   private:
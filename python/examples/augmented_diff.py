@@ -44,6 +44,7 @@ with osmx.Transaction(env) as txn:
     nodes = osmx.Nodes(txn)
     ways = osmx.Ways(txn)
     relations = osmx.Relations(txn)
+    strings = osmx.Strings(txn)
 
     def not_in_db(elem):
         elem_id = int(elem.get('id'))
@@ -72,7 +73,7 @@ with osmx.Transaction(env) as txn:
             o = relations.get(elem_id)
         if o:
             elem.set('version',str(o.metadata.version))
-            elem.set('user',str(o.metadata.user))
+            elem.set('user',str(strings.user(o.metadata)))
             elem.set('uid',str(o.metadata.uid))
             # convert to ISO8601 timestamp
             timestamp = o.metadata.timestamp
@@ -142,10 +143,10 @@ with osmx.Transaction(env) as txn:
                     prev_version.set('lat',ll[1])
                 elif action.element.tag == 'way':
                     way = ways.get(obj_id)
-                    for n in way.nodes:
+                    for n in osmx.way_nodes(way):
                         node = ET.SubElement(prev_version,'nd')
                         node.set('ref',str(n))
-                    it = iter(way.tags)
+                    it = iter(strings.tag_list(way))
                     for t in it:
                         tag = ET.SubElement(prev_version,'tag')
                         tag.set('k',t)
@@ -157,7 +158,7 @@ with osmx.Transaction(env) as txn:
                         member.set('ref',str(m.ref))
                         member.set('role',m.role)
                         member.set('type',str(m.type))
-                    it = iter(relation.tags)
+                    it = iter(strings.tag_list(relation))
                     for t in it:
                         tag = ET.SubElement(prev_version,'tag')
                         tag.set('k',t)
@@ -183,7 +184,7 @@ with osmx.Transaction(env) as txn:
                         nd.set('lon',ll[0])
                         nd.set('lat',ll[1])
             else:
-                for node_id in ways.get(ref).nodes:
+                for node_id in osmx.way_nodes(ways.get(ref)):
                     ll = get_lat_lon(str(node_id),use_new)
                     nd = ET.SubElement(mem,'nd')
                     nd.set('lon',ll[0])
@@ -258,10 +259,10 @@ with osmx.Transaction(env) as txn:
         way_element.set('id',str(w))
         set_old_metadata(way_element)
         way = ways.get(w)
-        for n in way.nodes:
+        for n in osmx.way_nodes(way):
             node = ET.SubElement(way_element,'nd')
             node.set('ref',str(n))
-        it = iter(way.tags)
+        it = iter(strings.tag_list(way))
         for t in it:
             tag = ET.SubElement(way_element,'tag')
             tag.set('k',t)
@@ -285,7 +286,7 @@ with osmx.Transaction(env) as txn:
             member.set('ref',str(m.ref))
             member.set('role',m.role)
             member.set('type',str(m.type))
-        it = iter(relation.tags)
+        it = iter(strings.tag_list(relation))
         for t in it:
             tag = ET.SubElement(relation_element,'tag')
             tag.set('k',t)
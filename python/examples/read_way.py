@@ -11,13 +11,14 @@ with osmx.Transaction(env) as txn:
     nodes = osmx.Nodes(txn)
     ways = osmx.Ways(txn)
     way_relation = osmx.WayRelation(txn)
+    strings = osmx.Strings(txn)
 
     way_id = sys.argv[2]
     way = ways.get(way_id)
 
-    for node_id in way.nodes:
+    for node_id in osmx.way_nodes(way):
         print(locations.get(node_id))
 
-    print(osmx.tag_dict(way.tags))
+    print(strings.tag_dict(way))
     print(way.metadata)
     print(way_relation.get(way_id))
@@ -27,6 +27,7 @@ class Handler(BaseHTTPRequestHandler):
         resp = {'type':'Feature','properties':{}}
         with osmx.Transaction(env) as txn:
             locations = osmx.Locations(txn)
+            strings = osmx.Strings(txn)
 
             def coord(node_id):
                 loc = locations.get(node_id)
@@ -36,23 +37,23 @@ class Handler(BaseHTTPRequestHandler):
             if parts[1] == "node":
                 node = nodes.get(osm_id)
                 if node:
-                    for k,v in osmx.tag_dict(node.tags).items():
+                    for k,v in strings.tag_dict(node).items():
                         resp['properties'][k] = v
 
                 resp['geometry'] = {'type':'Point','coordinates':coord(osm_id)}
             elif parts[1] == "way":
                 ways = osmx.Ways(txn)
                 way = ways.get(osm_id)
-                for k,v in osmx.tag_dict(way.tags).items():
+                for k,v in strings.tag_dict(way).items():
                     resp['properties'][k] = v
 
-                coords = [coord(node_id) for node_id in way.nodes]
+                coords = [coord(node_id) for node_id in osmx.way_nodes(way)]
                 resp['geometry'] = {'type':'LineString','coordinates':coords}
             elif parts[1] == "relation":
                 ways = osmx.Ways(txn)
                 relations = osmx.Relations(txn)
                 relation = relations.get(osm_id)
-                for k,v in osmx.tag_dict(relation.tags).items():
+                for k,v in strings.tag_dict(relation).items():
                     resp['properties'][k] = v
 
                 geometries = []
@@ -62,7 +63,7 @@ class Handler(BaseHTTPRequestHandler):
                             geometries.append({'type':'Point','coordinates':locations.get(member.ref)})
                         if member.type == 'way':
                             way = ways.get(member.ref)
-                            coords = [coord(node_id) for node_id in way.nodes]
+                            coords = [coord(node_id) for node_id in osmx.way_nodes(way)]
                             geometries.append({'type':'LineString','coordinates':coords})
                         if member.type == 'relation':
                             add_relation_geoms(relations.get(member.ref))
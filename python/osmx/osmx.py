@@ -13,9 +13,27 @@ def tag_dict(tag_list):
         d[x[1]] = next(it)[1]
     return d
 
+# node ids of a way, decoding packedNodes if the file was created with --pack-nodes.
+def way_nodes(way):
+    if len(way.packedNodes) == 0:
+        return list(way.nodes)
+    nodes = []
+    node_id = 0
+    v = 0
+    shift = 0
+    for b in way.packedNodes:
+        v |= (b & 0x7f) << shift
+        shift += 7
+        if not b & 0x80:
+            node_id += (v >> 1) ^ -(v & 1)
+            nodes.append(node_id)
+            v = 0
+            shift = 0
+    return nodes
+
 class Environment:
     def __init__(self,fname):
-        self._handle = lmdb.Environment(fname,max_dbs=10,readonly=True,readahead=False,subdir=False)
+        self._handle = lmdb.Environment(fname,max_dbs=32,readonly=True,readahead=False,subdir=False)
 
 class Transaction:
     def __init__(self,env):
@@ -48,10 +66,31 @@ class Index:
 class Table:
     def __init__(self,txn,name):
         self.txn = txn
-        self._handle = txn.env._handle.open_db(name,txn=txn._handle,integerkey=True,create=False)
+        # files expanded with --cluster store elements by position, found through a position table.
+        try:
+            self._positions = txn.env._handle.open_db(name + b'_position',txn=txn._handle,integerkey=True,create=False)
+            self._handle = txn.env._handle.open_db(name + b'_clustered',txn=txn._handle,integerkey=True,create=False)
+        except lmdb.NotFoundError:
+            self._positions = None
+            self._handle = txn.env._handle.open_db(name,txn=txn._handle,integerkey=True,create=False)
+        metadata = txn.env._handle.open_db(b'metadata',txn=txn._handle,create=False)
+        encoding = txn._handle.get(b'element_encoding',db=metadata)
+        self._packed = encoding is not None and bytes(encoding) == b'packed'
 
     def _get_bytes(self,elem_id):
-        return self.txn._handle.get(int(elem_id).to_bytes(8,byteorder=sys.byteorder),db=self._handle)
+        key = int(elem_id).to_bytes(8,byteorder=sys.byteorder)
+        if self._positions is not None:
+            key = self.txn._handle.get(key,db=self._positions)
+            if not key:
+                return None
+            key = bytes(key)
+        return self.txn._handle.get(key,db=self._handle)
+
+    # files expanded with --compress store elements in the capnp packed encoding.
+    def _from_bytes(self,struct,msg):
+        if self._packed:
+            return struct.from_bytes_packed(bytes(msg))
+        return struct.from_bytes(msg)
 
 class Locations(Table):
     def __init__(self,txn):
@@ -75,7 +114,7 @@ class Nodes(Table):
         msg = self._get_bytes(node_id)
         if not msg:
             return None
-        return messages_capnp.Node.from_bytes(msg)
+        return self._from_bytes(messages_capnp.Node,msg)
 
 class Ways(Table):
     def __init__(self,txn):
@@ -85,7 +124,7 @@ class Ways(Table):
         msg = self._get_bytes(way_id)
         if not msg:
             return None
-        return messages_capnp.Way.from_bytes(msg)
+        return self._from_bytes(messages_capnp.Way,msg)
 
 class Relations(Table):
     def __init__(self,txn):
@@ -95,7 +134,38 @@ class Relations(Table):
         msg = self._get_bytes(relation_id)
         if not msg:
             return None
-        return messages_capnp.Relation.from_bytes(msg)
+        return self._from_bytes(messages_capnp.Relation,msg)
+
+# strings are read as they are used and kept for the life of the txn, so opening the table is cheap.
+class Strings:
+    def __init__(self,txn):
+        self.txn = txn
+        self._strings = {}
+        try:
+            self._handle = txn.env._handle.open_db(b'strings',txn=txn._handle,integerkey=True,create=False)
+        except lmdb.NotFoundError:
+            self._handle = None
+
+    def get(self,code):
+        if code not in self._strings:
+            value = self.txn._handle.get(int(code).to_bytes(8,byteorder=sys.byteorder),db=self._handle)
+            self._strings[code] = bytes(value).decode('utf-8')
+        return self._strings[code]
+
+    # keys and values of a node, way or relation, with codes from the strings table resolved.
+    def tag_list(self,elem):
+        if len(elem.tagCodes) == 0:
+            return list(elem.tags)
+        literals = iter(elem.tags)
+        return [self.get(c) if c else next(literals) for c in elem.tagCodes]
+
+    def tag_dict(self,elem):
+        return tag_dict(self.tag_list(elem))
+
+    def user(self,metadata):
+        if metadata.userCode:
+            return self.get(metadata.userCode)
+        return metadata.user
 
 class NodeWay(Index):
     def __init__(self,txn):
@@ -0,0 +1,442 @@
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include "osmium/io/any_input.hpp"
+#include "cxxopts.hpp"
+#include "osmx/storage.h"
+#include "osmx/augmented_diff.h"
+
+using namespace std;
+
+namespace osmx {
+
+struct Member {
+  osmium::item_type type;
+  uint64_t ref;
+  string role;
+  // filled in when augmenting: the location of a node member, or the node locations of a way member.
+  osmium::Location location;
+  vector<osmium::Location> locations;
+};
+
+// one version of an object, from the .osmx file or the .osc.
+struct Element {
+  osmium::item_type type;
+  uint64_t id = 0;
+  bool visible = true;
+  // untagged nodes in the .osmx file only have a version.
+  bool hasMetadata = false;
+  int32_t version = 0;
+  string timestamp;
+  string user;
+  uint64_t uid = 0;
+  uint64_t changeset = 0;
+  osmium::Location location;
+  vector<uint64_t> nodes;
+  vector<osmium::Location> locations;
+  vector<Member> members;
+  vector<pair<string,string>> tags;
+};
+
+struct Action {
+  string type;
+  bool hasOld = false;
+  Element old;
+  Element current;
+};
+
+typedef pair<int,uint64_t> ObjectKey;
+
+static string escape(const string &s) {
+  string out;
+  for (char c : s) {
+    switch (c) {
+      case '&': out += "&amp;"; break;
+      case '<': out += "&lt;"; break;
+      case '>': out += "&gt;"; break;
+      case '"': out += "&quot;"; break;
+      case '\'': out += "&apos;"; break;
+      case '\n': out += "&#10;"; break;
+      default: out += c;
+    }
+  }
+  return out;
+}
+
+static Element fromObject(const osmium::OSMObject &object) {
+  Element e;
+  e.type = object.type();
+  e.id = object.id();
+  e.visible = object.visible();
+  e.hasMetadata = true;
+  e.version = object.version();
+  e.timestamp = object.timestamp().to_iso();
+  e.user = object.user();
+  e.uid = object.uid();
+  e.changeset = object.changeset();
+  for (auto const &tag : object.tags()) e.tags.emplace_back(tag.key(),tag.value());
+  if (object.type() == osmium::item_type::node) {
+    e.location = static_cast<const osmium::Node &>(object).location();
+  } else if (object.type() == osmium::item_type::way) {
+    for (auto const &node_ref : static_cast<const osmium::Way &>(object).nodes()) e.nodes.push_back(node_ref.ref());
+  } else {
+    for (auto const &member : static_cast<const osmium::Relation &>(object).members()) {
+      e.members.push_back(Member{member.type(),(uint64_t)member.ref(),member.role()});
+    }
+  }
+  return e;
+}
+
+class AugmentedDiff {
+  public:
+  AugmentedDiff(MDB_txn *txn) :
+    mTxn(txn),
+    mStrings(txn),
+    mLocations(txn),
+    mNodes(txn,"nodes"),
+    mWays(txn,"ways"),
+    mRelations(txn,"relations"),
+    mNodeWay(txn,"node_way"),
+    mNodeRelation(txn,"node_relation"),
+    mWayRelation(txn,"way_relation") {
+  }
+
+  void read(const string &oscPath) {
+    // only the newest version of each object is kept.
+    map<ObjectKey,Element> changes;
+    osmium::io::Reader reader{oscPath, osmium::osm_entity_bits::object};
+    while (osmium::memory::Buffer buffer = reader.read()) {
+      for (auto const &object : buffer.select<osmium::OSMObject>()) {
+        ObjectKey key{(int)object.type(),(uint64_t)object.id()};
+        auto found = changes.find(key);
+        if (found != changes.end() && object.version() < found->second.version) {
+          cout << "Found element " << key.second << ", version " << object.version() << " is less than previously visited version " << found->second.version << endl;
+          continue;
+        }
+        changes[key] = fromObject(object);
+      }
+    }
+    reader.close();
+
+    for (auto &change : changes) {
+      Action action;
+      action.current = change.second;
+      action.hasOld = fromDb(change.second.type,change.second.id,action.old);
+      if (!action.current.visible) {
+        action.type = "delete";
+        action.current.tags.clear();
+        action.current.nodes.clear();
+        action.current.members.clear();
+        action.current.location = osmium::Location{};
+      } else {
+        // objects created and then modified within the diff are creates too.
+        action.type = action.hasOld ? "modify" : "create";
+      }
+      mActions[change.first] = action;
+    }
+  }
+
+  void augment() {
+    for (auto &entry : mActions) {
+      auto &action = entry.second;
+      bool complete = true;
+      if (action.hasOld) complete = augment(action.old,false) && complete;
+      complete = augment(action.current,true) && complete;
+      if (!complete) cout << "Changed " << osmium::item_type_to_name(action.current.type) << " " << action.current.id << " is incomplete in db" << endl;
+    }
+  }
+
+  // when a node moves, the ways and relations it belongs to change geometry, and the relations of those ways.
+  // when the node list of a way changes, the relations it belongs to change.
+  void addAffected() {
+    Roaring64Map affected_ways;
+    Roaring64Map affected_relations;
+    for (auto const &entry : mActions) {
+      auto const &action = entry.second;
+      if (action.type != "modify") continue;
+      if (action.current.type == osmium::item_type::node) {
+        if (action.old.location == action.current.location) continue;
+        Roaring64Map ways;
+        mNodeRelation.traverseReverse(action.current.id,affected_relations);
+        mNodeWay.traverseReverse(action.current.id,ways);
+        for (auto way_id : ways) {
+          if (mActions.count({(int)osmium::item_type::way,way_id})) continue;
+          affected_ways.add(way_id);
+          mWayRelation.traverseReverse(way_id,affected_relations);
+        }
+      } else if (action.current.type == osmium::item_type::way) {
+        if (action.old.nodes == action.current.nodes) continue;
+        mWayRelation.traverseReverse(action.current.id,affected_relations);
+      }
+    }
+
+    for (auto way_id : affected_ways) addUnchanged(osmium::item_type::way,way_id,false);
+    for (auto relation_id : affected_relations) {
+      if (mActions.count({(int)osmium::item_type::relation,relation_id})) continue;
+      addUnchanged(osmium::item_type::relation,relation_id,true);
+    }
+  }
+
+  void write(const string &outputPath) {
+    ofstream out(outputPath);
+    out << std::fixed << std::setprecision(7);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
+    out << "<osm version=\"0.6\" generator=\"osmx augmented-diff\">" << endl;
+    out << "  <note>The data included in this document is from www.openstreetmap.org. The data is made available under ODbL.</note>" << endl;
+    for (auto const &entry : mActions) {
+      auto const &action = entry.second;
+      out << "  <action type=\"" << action.type << "\">" << endl;
+      out << "    <old>" << endl;
+      if (action.hasOld && action.type != "create") writeElement(out,action.old);
+      out << "    </old>" << endl;
+      out << "    <new>" << endl;
+      writeElement(out,action.current);
+      out << "    </new>" << endl;
+      out << "  </action>" << endl;
+    }
+    out << "</osm>" << endl;
+  }
+
+  private:
+  bool fromDb(osmium::item_type type, uint64_t id, Element &e) {
+    e.type = type;
+    e.id = id;
+    if (type == osmium::item_type::node) {
+      auto location = mLocations.get(id);
+      if (location.is_undefined()) return false;
+      e.location = location.coords;
+      e.version = location.version;
+      auto maybe_reader = mNodes.tryGet(id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        auto node = reader->getRoot<Node>();
+        setMetadata(e,node.getMetadata());
+        db::forEachTag(mStrings,node,[&](const char *key, const char *value) {
+          e.tags.emplace_back(key,value);
+        });
+      }
+      return true;
+    } else if (type == osmium::item_type::way) {
+      auto maybe_reader = mWays.tryGet(id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        auto way = reader->getRoot<Way>();
+        setMetadata(e,way.getMetadata());
+        db::forEachNode(way,[&](uint64_t node_id) {
+          e.nodes.push_back(node_id);
+        });
+        db::forEachTag(mStrings,way,[&](const char *key, const char *value) {
+          e.tags.emplace_back(key,value);
+        });
+        return true;
+      }
+      return false;
+    } else {
+      auto maybe_reader = mRelations.tryGet(id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        auto relation = reader->getRoot<Relation>();
+        setMetadata(e,relation.getMetadata());
+        for (auto const &member : relation.getMembers()) {
+          osmium::item_type member_type = osmium::item_type::relation;
+          if (member.getType() == RelationMember::Type::NODE) member_type = osmium::item_type::node;
+          else if (member.getType() == RelationMember::Type::WAY) member_type = osmium::item_type::way;
+          e.members.push_back(Member{member_type,member.getRef(),member.getRole()});
+        }
+        db::forEachTag(mStrings,relation,[&](const char *key, const char *value) {
+          e.tags.emplace_back(key,value);
+        });
+        return true;
+      }
+      return false;
+    }
+  }
+
+  void setMetadata(Element &e, ::Metadata::Reader metadata) {
+    e.hasMetadata = true;
+    e.version = metadata.getVersion();
+    e.timestamp = osmium::Timestamp(metadata.getTimestamp()).to_iso();
+    e.user = db::getUser(mStrings,metadata);
+    e.uid = metadata.getUid();
+    e.changeset = metadata.getChangeset();
+  }
+
+  // the location of a node before the diff, or after it if useNew.
+  osmium::Location location(uint64_t node_id, bool useNew) {
+    if (useNew) {
+      auto found = mActions.find({(int)osmium::item_type::node,node_id});
+      if (found != mActions.end()) return found->second.current.location;
+    }
+    return mLocations.get(node_id).coords;
+  }
+
+  bool wayNodes(uint64_t way_id, bool useNew, vector<uint64_t> &nodes) {
+    if (useNew) {
+      auto found = mActions.find({(int)osmium::item_type::way,way_id});
+      if (found != mActions.end()) {
+        nodes = found->second.current.nodes;
+        return found->second.current.visible;
+      }
+    }
+    auto maybe_reader = mWays.tryGet(way_id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      db::forEachNode(reader->getRoot<Way>(),[&](uint64_t node_id) {
+        nodes.push_back(node_id);
+      });
+      return true;
+    }
+    return false;
+  }
+
+  // adds locations to way nodes and relation members. false if any are missing.
+  bool augment(Element &e, bool useNew) {
+    bool complete = true;
+    if (e.type == osmium::item_type::way) {
+      e.locations.clear();
+      for (auto node_id : e.nodes) {
+        e.locations.push_back(location(node_id,useNew));
+        if (!e.locations.back().valid()) complete = false;
+      }
+    } else if (e.type == osmium::item_type::relation) {
+      for (auto &member : e.members) {
+        if (member.type == osmium::item_type::node) {
+          member.location = location(member.ref,useNew);
+          if (!member.location.valid()) complete = false;
+        } else if (member.type == osmium::item_type::way) {
+          vector<uint64_t> nodes;
+          member.locations.clear();
+          if (!wayNodes(member.ref,useNew,nodes)) complete = false;
+          for (auto node_id : nodes) {
+            member.locations.push_back(location(node_id,useNew));
+            if (!member.locations.back().valid()) complete = false;
+          }
+        }
+      }
+    }
+    return complete;
+  }
+
+  // a modify action for an object that is not in the diff but whose geometry changed.
+  void addUnchanged(osmium::item_type type, uint64_t id, bool skipIncomplete) {
+    Action action;
+    action.type = "modify";
+    if (!fromDb(type,id,action.old)) return;
+    action.hasOld = true;
+    action.current = action.old;
+    bool complete = augment(action.old,false);
+    complete = augment(action.current,true) && complete;
+    if (!complete) {
+      cout << "Affected " << osmium::item_type_to_name(type) << " " << id << " is incomplete in db" << endl;
+      if (skipIncomplete) return;
+    }
+    mActions[{(int)type,id}] = action;
+  }
+
+  void writeBounds(ofstream &out, const vector<const osmium::Location *> &locations) {
+    osmium::Box box;
+    for (auto location : locations) {
+      if (location->valid()) box.extend(*location);
+    }
+    if (!box.valid()) return;
+    out << "        <bounds minlat=\"" << box.bottom_left().lat() << "\" minlon=\"" << box.bottom_left().lon() << "\" maxlat=\"" << box.top_right().lat() << "\" maxlon=\"" << box.top_right().lon() << "\"/>" << endl;
+  }
+
+  void writeLocation(ofstream &out, const osmium::Location &location) {
+    if (location.valid()) out << " lat=\"" << location.lat() << "\" lon=\"" << location.lon() << "\"";
+  }
+
+  void writeElement(ofstream &out, const Element &e) {
+    out << "      <" << osmium::item_type_to_name(e.type) << " id=\"" << e.id << "\"";
+    if (!e.visible) out << " visible=\"false\"";
+    out << " version=\"" << e.version << "\"";
+    if (e.hasMetadata) {
+      out << " timestamp=\"" << e.timestamp << "\" changeset=\"" << e.changeset << "\" uid=\"" << e.uid << "\" user=\"" << escape(e.user) << "\"";
+    }
+    if (e.type == osmium::item_type::node) writeLocation(out,e.location);
+    out << ">" << endl;
+
+    if (e.type == osmium::item_type::way) {
+      vector<const osmium::Location *> all;
+      for (auto const &location : e.locations) all.push_back(&location);
+      writeBounds(out,all);
+      for (size_t i = 0; i < e.nodes.size(); i++) {
+        out << "        <nd ref=\"" << e.nodes[i] << "\"";
+        if (i < e.locations.size()) writeLocation(out,e.locations[i]);
+        out << "/>" << endl;
+      }
+    } else if (e.type == osmium::item_type::relation) {
+      vector<const osmium::Location *> all;
+      for (auto const &member : e.members) {
+        for (auto const &location : member.locations) all.push_back(&location);
+      }
+      writeBounds(out,all);
+      for (auto const &member : e.members) {
+        out << "        <member type=\"" << osmium::item_type_to_name(member.type) << "\" ref=\"" << member.ref << "\" role=\"" << escape(member.role) << "\"";
+        if (member.type == osmium::item_type::node) writeLocation(out,member.location);
+        if (member.locations.empty()) {
+          out << "/>" << endl;
+          continue;
+        }
+        out << ">" << endl;
+        for (auto const &location : member.locations) {
+          out << "          <nd";
+          writeLocation(out,location);
+          out << "/>" << endl;
+        }
+        out << "        </member>" << endl;
+      }
+    }
+
+    for (auto const &tag : e.tags) {
+      out << "        <tag k=\"" << escape(tag.first) << "\" v=\"" << escape(tag.second) << "\"/>" << endl;
+    }
+    out << "      </" << osmium::item_type_to_name(e.type) << ">" << endl;
+  }
+
+  // sorted by type, then id.
+  map<ObjectKey,Action> mActions;
+  MDB_txn *mTxn;
+  db::StringTable mStrings;
+  db::Locations mLocations;
+  db::Elements mNodes;
+  db::Elements mWays;
+  db::Elements mRelations;
+  db::IndexCursor mNodeWay;
+  db::IndexCursor mNodeRelation;
+  db::IndexCursor mWayRelation;
+};
+
+void writeAugmentedDiff(MDB_txn *txn, const string &oscPath, const string &outputPath) {
+  AugmentedDiff diff(txn);
+  diff.read(oscPath);
+  diff.augment();
+  diff.addAffected();
+  diff.write(outputPath);
+}
+
+}
+
+void cmdAugmentedDiff(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("AugmentedDiff", "Create an augmented diff for an .osc.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("osc", "The .osc to describe", cxxopts::value<string>())
+    ("output", "Output file", cxxopts::value<string>())
+  ;
+  cmdoptions.parse_positional({"cmd","osmx","osc","output"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("osmx") == 0 || result.count("osc") == 0 || result.count("output") == 0) {
+    cout << "Usage: osmx augmented-diff OSMX_FILE OSC_FILE OUTPUT_FILE" << endl;
+    cout << "Writes an augmented diff for OSC_FILE, which must be the next update for OSMX_FILE and not yet applied." << endl;
+    cout << "osmx update --augmented-diff FILE does the same while applying the update." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx augmented-diff planet.osmx 123456.osc 123456.adiff" << endl;
+    exit(1);
+  }
+
+  MDB_env* env = osmx::db::createEnv(result["osmx"].as<string>(),false);
+  MDB_txn* txn;
+  CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+  osmx::writeAugmentedDiff(txn,result["osc"].as<string>(),result["output"].as<string>());
+  mdb_txn_abort(txn);
+  mdb_env_close(env);
+}
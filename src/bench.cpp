@@ -0,0 +1,244 @@
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cxxopts.hpp"
+#include "nlohmann/json.hpp"
+#include "s2/s2latlng.h"
+#include "s2/s2latlng_rect.h"
+#include "s2/s2region_coverer.h"
+#include "osmx/storage.h"
+#include "osmx/sorter.h"
+#include "osmx/synthetic.h"
+#include "osmx/cmd.h"
+
+using namespace std;
+using namespace osmx;
+
+class Bench {
+  public:
+  Bench(bool json) : mJson(json) { }
+
+  // runs fn, which performs ops operations, and records how long it took.
+  template <typename F>
+  void run(const string &name, uint64_t ops, F fn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000000.0;
+    double ns_per_op = ops > 0 ? seconds * 1000000000.0 / ops : 0;
+    mResults.push_back({{"name",name},{"ops",ops},{"seconds",seconds},{"ns_per_op",ns_per_op}});
+    if (!mJson) cout << name << ": " << ops << " ops in " << seconds << " seconds (" << ns_per_op << " ns/op)" << endl;
+  }
+
+  nlohmann::json results() const {
+    return mResults;
+  }
+
+  private:
+  bool mJson;
+  nlohmann::json mResults = nlohmann::json::array();
+};
+
+static vector<char *> makeArgs(vector<string> &args) {
+  vector<char *> argv;
+  for (auto &arg : args) argv.push_back((char *)arg.c_str());
+  argv.push_back(nullptr);
+  return argv;
+}
+
+void cmdBench(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Bench", "Benchmark osmx on a synthetic dataset.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("dir", "Directory for generated files", cxxopts::value<string>())
+    ("nodes", "Number of nodes in the dataset", cxxopts::value<uint64_t>())
+    ("ops", "Number of operations for each micro benchmark", cxxopts::value<uint64_t>())
+    ("seed", "Random seed for the dataset and lookups", cxxopts::value<uint64_t>())
+    ("json", "Print results as JSON")
+    ("expand-variants", "Also expand the dataset with each bulk loading option")
+  ;
+  cmdoptions.parse_positional({"cmd","dir"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("dir") == 0) {
+    cout << "Usage: osmx bench DIR [OPTIONS]" << endl;
+    cout << "Generates a synthetic dataset in DIR and measures expand, extract, update and the storage primitives." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx bench /tmp --nodes 10000000 --json" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --nodes N: number of nodes in the generated dataset, default 1000000." << endl;
+    cout << " --ops N: number of operations for each micro benchmark, default 1000000." << endl;
+    cout << " --seed N: random seed for the dataset and lookups, default 0." << endl;
+    cout << " --json: print results as a JSON object." << endl;
+    cout << " --expand-variants: also expand the whole dataset with --commit-interval, --writemap and one thread, which takes several times longer." << endl;
+    exit(1);
+  }
+
+  string dir = result["dir"].as<string>();
+  SyntheticOptions synthetic;
+  if (result.count("nodes")) synthetic.nodes = result["nodes"].as<uint64_t>();
+  uint64_t ops = result.count("ops") ? result["ops"].as<uint64_t>() : 1000000;
+  uint64_t seed = result.count("seed") ? result["seed"].as<uint64_t>() : 0;
+  synthetic.seed = seed;
+  bool json = result.count("json") > 0;
+
+  string pbf = dir + "/bench.osm.pbf";
+  string osc = dir + "/bench.osc";
+  string osmx = dir + "/bench.osmx";
+  string extract = dir + "/bench_extract.osm.pbf";
+  string tempDir = dir + "/bench-temp";
+  unlink(osmx.c_str());
+  unlink((osmx + "-lock").c_str());
+
+  // the commands run with --quiet, and the sorter's progress is turned off too, so only results are printed.
+  quiet() = true;
+  Bench bench(json);
+  SyntheticStats stats;
+  SyntheticStats changeStats;
+  bench.run("generate",synthetic.nodes,[&]() {
+    stats = writeSynthetic(pbf,synthetic);
+    changeStats = writeSyntheticChange(osc,synthetic);
+  });
+
+  bench.run("expand",stats.nodes + stats.ways + stats.relations,[&]() {
+    vector<string> args{"osmx","expand",pbf,osmx,"--quiet"};
+    auto argv = makeArgs(args);
+    cmdExpand(argv.size() - 1,argv.data());
+  });
+
+  // the bulk loading and decoding options, against the default expand above.
+  // each expands the whole dataset again, so they only run when asked for.
+  if (result.count("expand-variants")) {
+    string bulk = dir + "/bench_bulk.osmx";
+    vector<pair<string,vector<string>>> variants{
+      {"expand_commit_interval",{"--commit-interval","100000"}},
+      {"expand_writemap",{"--commit-interval","100000","--writemap"}},
+      {"expand_one_thread",{"--threads","1"}}
+    };
+    for (auto const &variant : variants) {
+      unlink(bulk.c_str());
+      unlink((bulk + "-lock").c_str());
+      bench.run(variant.first,stats.nodes + stats.ways + stats.relations,[&]() {
+        vector<string> args{"osmx","expand",pbf,bulk,"--quiet"};
+        args.insert(args.end(),variant.second.begin(),variant.second.end());
+        auto argv = makeArgs(args);
+        cmdExpand(argv.size() - 1,argv.data());
+      });
+    }
+    unlink(bulk.c_str());
+    unlink((bulk + "-lock").c_str());
+  }
+
+  // the storage primitives on the file, then on a copy in memory.
+  for (string suffix : {"","_memory"}) {
+    MDB_env *env = suffix.empty() ? db::createEnv(osmx) : db::createMemoryEnv(osmx);
+    MDB_txn *txn;
+    CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint64_t> node_ids(1,stats.maxNodeId);
+    std::uniform_int_distribution<uint64_t> way_ids(1,stats.maxWayId);
+    uint64_t found = 0;
+
+    bench.run("locations_get" + suffix,ops,[&]() {
+      db::Locations locations(txn);
+      for (uint64_t i = 0; i < ops; i++) {
+        if (locations.get(node_ids(rng)).is_defined()) found++;
+      }
+    });
+
+    // ids in increasing order, as extract reads them from a bitmap.
+    bench.run("locations_sorted" + suffix,ops,[&]() {
+      db::Locations locations(txn);
+      for (uint64_t i = 0; i < ops; i++) {
+        if (locations.get(1 + i % stats.maxNodeId).is_defined()) found++;
+      }
+    });
+
+    bench.run("locations_sorted_cursor" + suffix,ops,[&]() {
+      db::LocationCursor locations(txn);
+      for (uint64_t i = 0; i < ops; i++) {
+        if (locations.get(1 + i % stats.maxNodeId).is_defined()) found++;
+      }
+    });
+
+    bench.run("elements_get" + suffix,ops,[&]() {
+      db::Elements ways(txn,"ways");
+      for (uint64_t i = 0; i < ops; i++) {
+        auto maybe_reader = ways.tryGet(way_ids(rng));
+        KJ_IF_MAYBE(reader, maybe_reader) {
+          if (reader->getRoot<Way>().getMetadata().getVersion() > 0) found++;
+        }
+      }
+    });
+
+    bench.run("traverse_reverse" + suffix,ops,[&]() {
+      db::IndexCursor node_way(txn,"node_way");
+      Roaring64Map way_set;
+      for (uint64_t i = 0; i < ops; i++) {
+        node_way.traverseReverse(node_ids(rng),way_set);
+      }
+      found += way_set.cardinality();
+    });
+
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1024);
+    options.set_max_level(CELL_INDEX_LEVEL);
+    S2RegionCoverer coverer(options);
+    auto lo = synthetic.bounds.bottom_left();
+    auto hi = synthetic.bounds.top_right();
+    S2CellUnion covering = coverer.GetCovering(S2LatLngRect(S2LatLng::FromDegrees(lo.lat(),lo.lon()),S2LatLng::FromDegrees(hi.lat(),hi.lon())));
+    bench.run("traverse_cell" + suffix,covering.size(),[&]() {
+      db::IndexCursor cell_node(txn,"cell_node");
+      Roaring64Map node_set;
+      for (auto cell_id : covering.cell_ids()) {
+        cell_node.traverseCell(cell_id,node_set);
+      }
+      found += node_set.cardinality();
+    });
+
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+    // keeps the lookups from being optimized away.
+    if (!json) cout << "found: " << found << endl;
+  }
+
+  bench.run("sorter",ops,[&]() {
+    mkdir(tempDir.c_str(),S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    std::mt19937_64 rng(seed);
+    Sorter sorter(tempDir,"bench");
+    for (uint64_t i = 0; i < ops; i++) sorter.put(rng(),i);
+    uint64_t sorted = 0;
+    sorter.merge([&](uint64_t from, uint64_t to) { sorted++; });
+    if (sorted != ops) cerr << "sorter returned " << sorted << " of " << ops << endl;
+    rmdir(tempDir.c_str());
+  });
+
+  // the central quarter of the dataset.
+  auto lo = synthetic.bounds.bottom_left();
+  auto hi = synthetic.bounds.top_right();
+  double lat_span = hi.lat() - lo.lat();
+  double lon_span = hi.lon() - lo.lon();
+  stringstream bbox;
+  bbox << std::fixed << std::setprecision(7) << lo.lat() + lat_span / 4 << "," << lo.lon() + lon_span / 4 << "," << lo.lat() + lat_span * 3 / 4 << "," << lo.lon() + lon_span * 3 / 4;
+  bench.run("extract",stats.nodes / 4,[&]() {
+    vector<string> args{"osmx","extract",osmx,extract,"--bbox",bbox.str(),"--quiet"};
+    auto argv = makeArgs(args);
+    cmdExtract(argv.size() - 1,argv.data());
+  });
+
+  bench.run("update",changeStats.nodes + changeStats.ways + changeStats.relations,[&]() {
+    vector<string> args{"osmx","update",osmx,osc,"2","2020-01-02T00:00:00Z","--commit","--quiet"};
+    auto argv = makeArgs(args);
+    cmdUpdate(argv.size() - 1,argv.data());
+  });
+
+  if (json) {
+    nlohmann::json output;
+    output["dataset"] = {{"nodes",stats.nodes},{"ways",stats.ways},{"relations",stats.relations}};
+    output["ops"] = ops;
+    output["seed"] = seed;
+    output["results"] = bench.results();
+    cout << output.dump() << endl;
+  }
+}
@@ -0,0 +1,129 @@
+#include "osmium/builder/osm_object_builder.hpp"
+#include "osmx/builder.h"
+
+namespace osmx {
+
+ObjectBuilder::ObjectBuilder(MDB_txn *txn, bool includeUserData) :
+  mIncludeUserData(includeUserData),
+  mStrings(txn),
+  mLocations(txn),
+  mNodes(txn,"nodes"),
+  mWays(txn,"ways"),
+  mRelations(txn,"relations") {
+}
+
+bool ObjectBuilder::node(osmium::memory::Buffer &buffer, uint64_t id) {
+  auto loc = mLocations.get(id);
+  if (loc.is_undefined()) return false;
+
+  osmium::builder::NodeBuilder node_builder{buffer};
+  node_builder.set_id(id);
+  node_builder.set_location(loc.coords);
+  node_builder.set_version(loc.version);
+
+  // untagged nodes are only in the locations table.
+  auto maybe_reader = mNodes.tryGet(id);
+  KJ_IF_MAYBE(reader, maybe_reader) {
+    Node::Reader node = reader->getRoot<Node>();
+    auto metadata = node.getMetadata();
+    node_builder.set_timestamp(metadata.getTimestamp());
+    if (mIncludeUserData) {
+      node_builder.set_changeset(metadata.getChangeset());
+      node_builder.set_user(db::getUser(mStrings,metadata));
+      node_builder.set_uid(metadata.getUid());
+    }
+
+    osmium::builder::TagListBuilder tag_builder{node_builder};
+    db::forEachTag(mStrings,node,[&](const char *key, const char *value) {
+      tag_builder.add_tag(key,value);
+    });
+  }
+  return true;
+}
+
+bool ObjectBuilder::way(osmium::memory::Buffer &buffer, uint64_t id) {
+  auto maybe_reader = mWays.tryGet(id);
+  KJ_IF_MAYBE(reader, maybe_reader) {
+    Way::Reader way = reader->getRoot<Way>();
+    osmium::builder::WayBuilder way_builder{buffer};
+    way_builder.set_id(id);
+    auto metadata = way.getMetadata();
+    way_builder.set_version(metadata.getVersion());
+    way_builder.set_timestamp(metadata.getTimestamp());
+    if (mIncludeUserData) {
+      way_builder.set_changeset(metadata.getChangeset());
+      way_builder.set_user(db::getUser(mStrings,metadata));
+      way_builder.set_uid(metadata.getUid());
+    }
+
+    {
+      osmium::builder::WayNodeListBuilder way_node_list_builder{way_builder};
+      db::forEachNode(way,[&](uint64_t node_id) {
+        way_node_list_builder.add_node_ref(node_id);
+      });
+    }
+
+    osmium::builder::TagListBuilder tag_builder{way_builder};
+    db::forEachTag(mStrings,way,[&](const char *key, const char *value) {
+      tag_builder.add_tag(key,value);
+    });
+    return true;
+  }
+  return false;
+}
+
+bool ObjectBuilder::relation(osmium::memory::Buffer &buffer, uint64_t id) {
+  auto maybe_reader = mRelations.tryGet(id);
+  KJ_IF_MAYBE(reader, maybe_reader) {
+    Relation::Reader relation = reader->getRoot<Relation>();
+    osmium::builder::RelationBuilder relation_builder{buffer};
+    relation_builder.set_id(id);
+
+    auto metadata = relation.getMetadata();
+    relation_builder.set_version(metadata.getVersion());
+    relation_builder.set_timestamp(metadata.getTimestamp());
+    if (mIncludeUserData) {
+      relation_builder.set_changeset(metadata.getChangeset());
+      relation_builder.set_user(db::getUser(mStrings,metadata));
+      relation_builder.set_uid(metadata.getUid());
+    }
+
+    {
+      osmium::builder::RelationMemberListBuilder relation_member_list_builder{relation_builder};
+      for (auto const &member : relation.getMembers()) {
+        if (member.getType() == RelationMember::Type::NODE) {
+          relation_member_list_builder.add_member(osmium::item_type::node,member.getRef(),member.getRole());
+        } else if (member.getType() == RelationMember::Type::WAY) {
+          relation_member_list_builder.add_member(osmium::item_type::way,member.getRef(),member.getRole());
+        } else {
+          relation_member_list_builder.add_member(osmium::item_type::relation,member.getRef(),member.getRole());
+        }
+      }
+    }
+
+    osmium::builder::TagListBuilder tag_builder{relation_builder};
+    db::forEachTag(mStrings,relation,[&](const char *key, const char *value) {
+      tag_builder.add_tag(key,value);
+    });
+    return true;
+  }
+  return false;
+}
+
+void ObjectBuilder::deleted(osmium::memory::Buffer &buffer, osmium::item_type type, uint64_t id) {
+  if (type == osmium::item_type::node) {
+    osmium::builder::NodeBuilder builder{buffer};
+    builder.set_id(id);
+    builder.set_visible(false);
+  } else if (type == osmium::item_type::way) {
+    osmium::builder::WayBuilder builder{buffer};
+    builder.set_id(id);
+    builder.set_visible(false);
+  } else {
+    osmium::builder::RelationBuilder builder{buffer};
+    builder.set_id(id);
+    builder.set_visible(false);
+  }
+}
+
+}
@@ -0,0 +1,226 @@
+#include <string>
+#include "s2/s2latlng.h"
+#include "s2/s2region_coverer.h"
+#include "osmium/io/any_output.hpp"
+#include "osmium/memory/callback_buffer.hpp"
+#include "cxxopts.hpp"
+#include "osmx/storage.h"
+#include "osmx/region.h"
+#include "osmx/builder.h"
+#include "osmx/changes.h"
+
+using namespace std;
+using namespace osmx;
+
+// selects the changed objects that are in a region:
+// nodes in the covering, ways with a node in the covering, and relations with a member in either.
+class RegionFilter {
+  public:
+  RegionFilter(MDB_txn *txn, const S2CellUnion &covering) : mCovering(covering), mLocations(txn), mWays(txn,"ways"), mRelations(txn,"relations") { }
+
+  bool node(uint64_t id) {
+    auto location = mLocations.get(id);
+    if (location.is_undefined()) return false;
+    return mCovering.Contains(S2CellId(S2LatLng::FromDegrees(location.coords.lat(),location.coords.lon())));
+  }
+
+  bool way(uint64_t id) {
+    bool found = false;
+    auto maybe_reader = mWays.tryGet(id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      db::forEachNode(reader->getRoot<Way>(),[&](uint64_t node_id) {
+        if (!found && node(node_id)) found = true;
+      });
+    }
+    return found;
+  }
+
+  bool relation(uint64_t id, const Roaring64Map &node_ids, const Roaring64Map &way_ids) {
+    auto maybe_reader = mRelations.tryGet(id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      for (auto const &member : reader->getRoot<Relation>().getMembers()) {
+        auto ref = member.getRef();
+        if (member.getType() == RelationMember::Type::NODE) {
+          if (node_ids.contains(ref) || node(ref)) return true;
+        } else if (member.getType() == RelationMember::Type::WAY) {
+          if (way_ids.contains(ref) || way(ref)) return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  private:
+  const S2CellUnion &mCovering;
+  db::Locations mLocations;
+  db::Elements mWays;
+  db::Elements mRelations;
+};
+
+void osmx::selectChanges(MDB_txn *txn, const S2CellUnion &covering, const db::ChangeSet &changes, db::ChangeSet &selected) {
+  RegionFilter filter(txn,covering);
+  db::IndexCursor node_way(txn,"node_way");
+  for (auto id : changes.nodes) {
+    if (filter.node(id)) {
+      selected.nodes.add(id);
+      continue;
+    }
+    // a node that moved out of the region is still written if a way in the region uses it.
+    Roaring64Map parents;
+    node_way.traverseReverse(id,parents);
+    for (auto way_id : parents) {
+      if (filter.way(way_id)) {
+        selected.nodes.add(id);
+        break;
+      }
+    }
+  }
+  for (auto id : changes.ways) if (filter.way(id)) selected.ways.add(id);
+  for (auto id : changes.relations) if (filter.relation(id,selected.nodes,selected.ways)) selected.relations.add(id);
+
+  // like an extract, include all nodes of the ways, in case a way was extended outside the region.
+  db::Elements ways(txn,"ways");
+  for (auto id : selected.ways) {
+    auto maybe_reader = ways.tryGet(id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      db::forEachNode(reader->getRoot<Way>(),[&](uint64_t node_id) {
+        selected.nodes.add(node_id);
+      });
+    }
+  }
+}
+
+void cmdChanges(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Changes", "Write a regional .osc between two sequence numbers.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("output", "Output .osc", cxxopts::value<string>())
+    ("from", "Sequence number the extract is at", cxxopts::value<uint64_t>())
+    ("to", "Last sequence number to include", cxxopts::value<uint64_t>())
+    ("noUserData", "Don't include changeset,uid,user fields (GDPR compliance)")
+    ("bbox", "rectangle in minLat,minLon,maxLat,maxLon", cxxopts::value<string>())
+    ("disc", "disc in centerLat,centerLon,radiusDegrees", cxxopts::value<string>())
+    ("geojson","geoJson of region", cxxopts::value<string>())
+    ("poly","osmosis .poly of region", cxxopts::value<string>())
+    ("region","file for region with extension .bbox, .disc, .json or .poly", cxxopts::value<string>())
+  ;
+  cmdoptions.parse_positional({"cmd","osmx","output","from","to"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("osmx") == 0 || result.count("output") == 0 || result.count("from") == 0) {
+    cout << "Usage: osmx changes OSMX_FILE OUTPUT_OSC FROM [TO] [OPTIONS]" << endl;
+    cout << "Writes the objects in a region changed by the updates after FROM, up to TO or the latest update." << endl;
+    cout << "Changed objects that are not in the region, because they were deleted or moved out of it, are written as deletes." << endl;
+    cout << "Requires updates applied with --changelog. Objects are written as they are now, so TO is only useful to leave out later updates that touched other objects." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx changes planet.osmx 3751234.osc 3751200 --region region.json" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --noUserData: don't include changeset, uid and user fields." << endl;
+    cout << " --bbox, --disc, --geojson, --poly, --region: the region, as for osmx extract. Without one, all changes are written." << endl;
+    exit(1);
+  }
+
+  std::unique_ptr<Region> region;
+  if (result.count("bbox")) region = std::make_unique<Region>(result["bbox"].as<string>(),"bbox");
+  else if (result.count("disc")) region = std::make_unique<Region>(result["disc"].as<string>(),"disc");
+  else if (result.count("geojson")) region = std::make_unique<Region>(result["geojson"].as<string>(),"geojson");
+  else if (result.count("poly")) region = std::make_unique<Region>(result["poly"].as<string>(),"poly");
+  else if (result.count("region")) region = Region::FromFile(result["region"].as<string>());
+
+  MDB_env* env = db::createEnv(result["osmx"].as<string>(),false);
+  MDB_txn* txn;
+  CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+
+  db::Metadata metadata(txn);
+  string seqnum = metadata.get("osmosis_replication_sequence_number");
+  if (result.count("to") == 0 && seqnum.empty()) {
+    cout << result["osmx"].as<string>() << " has no sequence number, so TO must be given." << endl;
+    exit(1);
+  }
+  uint64_t from = result["from"].as<uint64_t>();
+  uint64_t to = result.count("to") ? result["to"].as<uint64_t>() : stoull(seqnum);
+
+  if (to <= from) {
+    cout << "TO must be after FROM." << endl;
+    exit(1);
+  }
+
+  db::Changelog changelog(txn);
+  if (!changelog.present()) {
+    cout << "No changelog: apply updates with osmx update --changelog." << endl;
+    exit(1);
+  }
+  db::ChangeSet changes;
+  uint64_t sequences = changelog.get(from,to,changes);
+  if (sequences < to - from) {
+    cout << "Warning: only " << sequences << " of " << to - from << " sequences are in the changelog." << endl;
+  }
+
+  db::ChangeSet selected;
+  if (region) {
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1024);
+    options.set_max_level(CELL_INDEX_LEVEL);
+    S2RegionCoverer coverer(options);
+    S2CellUnion covering = region->GetCovering(coverer);
+    selectChanges(txn,covering,changes,selected);
+  } else {
+    selected.nodes = changes.nodes;
+    selected.ways = changes.ways;
+    selected.relations = changes.relations;
+  }
+
+  osmium::io::Header header;
+  header.set("generator", "osmx");
+  header.set("osmosis_replication_sequence_number", to_string(to));
+  header.set("osmosis_replication_timestamp", metadata.get("osmosis_replication_timestamp"));
+  osmium::io::Writer writer{result["output"].as<string>(), header, osmium::io::overwrite::allow};
+  osmium::memory::CallbackBuffer cb;
+  cb.set_callback([&](osmium::memory::Buffer&& buffer) {
+    writer(std::move(buffer));
+  });
+
+  // changed objects that are not selected were deleted, or have left the region, and are written as deletes.
+  // deleted objects have no location anymore, so deletes are not filtered by region;
+  // applying a delete of an object that isn't in the extract does nothing.
+  ObjectBuilder builder(txn,result.count("noUserData") == 0);
+  uint64_t deleted = 0;
+  Roaring64Map node_ids = changes.nodes;
+  node_ids |= selected.nodes;
+  for (auto id : node_ids) {
+    if (selected.nodes.contains(id) && builder.node(cb.buffer(),id)) {
+      cb.buffer().commit();
+    } else {
+      ObjectBuilder::deleted(cb.buffer(),osmium::item_type::node,id);
+      cb.buffer().commit();
+      deleted++;
+    }
+    cb.possibly_flush();
+  }
+  for (auto id : changes.ways) {
+    if (selected.ways.contains(id) && builder.way(cb.buffer(),id)) {
+      cb.buffer().commit();
+    } else {
+      ObjectBuilder::deleted(cb.buffer(),osmium::item_type::way,id);
+      cb.buffer().commit();
+      deleted++;
+    }
+    cb.possibly_flush();
+  }
+  for (auto id : changes.relations) {
+    if (selected.relations.contains(id) && builder.relation(cb.buffer(),id)) {
+      cb.buffer().commit();
+    } else {
+      ObjectBuilder::deleted(cb.buffer(),osmium::item_type::relation,id);
+      cb.buffer().commit();
+      deleted++;
+    }
+    cb.possibly_flush();
+  }
+  cb.flush();
+  writer.close();
+  mdb_env_close(env);
+
+  cout << "Sequences " << from << " to " << to << ": " << selected.nodes.cardinality() << " nodes, " << selected.ways.cardinality() << " ways, " << selected.relations.cardinality() << " relations, " << deleted << " deleted" << endl;
+}
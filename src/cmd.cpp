@@ -11,7 +11,15 @@ void printHelp() {
   cout << " expand   Convert an OSM PBF or XML to an osmx database." << endl;
   cout << " extract  Create a regional extract PBF from an osmx database." << endl;
   cout << " update   Apply an OSM changeset to an osmx database." << endl;
+  cout << " changes  Write a regional change file between two sequence numbers." << endl;
+  cout << " augmented-diff Write an augmented diff for an OSM changeset." << endl;
+  cout << " export   Write the features in a region as GeoJSON or WKB geometries." << endl;
+  cout << " snapshot Write a compacted copy of an osmx database for readers." << endl;
+  cout << " stat     Print table statistics of an osmx database." << endl;
+  cout << " compact  Rewrite an osmx database with its tables in key order." << endl;
   cout << " query    Look up objects by ID in an osmx database." << endl;
+  cout << " bench    Benchmark osmx on a synthetic dataset." << endl;
+  cout << " synthetic Generate a synthetic OSM dataset and change file." << endl;
   exit(1);
 }
 
@@ -41,6 +49,22 @@ int main(int argc, char* argv[]) {
     cmdExtract(argc,argv);
   } else if (args[1] == "update") {
     cmdUpdate(argc,argv);
+  } else if (args[1] == "changes") {
+    cmdChanges(argc,argv);
+  } else if (args[1] == "augmented-diff") {
+    cmdAugmentedDiff(argc,argv);
+  } else if (args[1] == "export") {
+    cmdExport(argc,argv);
+  } else if (args[1] == "snapshot") {
+    cmdSnapshot(argc,argv);
+  } else if (args[1] == "stat") {
+    cmdStat(argc,argv);
+  } else if (args[1] == "compact") {
+    cmdCompact(argc,argv);
+  } else if (args[1] == "bench") {
+    cmdBench(argc,argv);
+  } else if (args[1] == "synthetic") {
+    cmdSynthetic(argc,argv);
   } else if (args[1] == "query") {
     if (args.size() == 2) {
       printQueryHelp();
@@ -50,39 +74,49 @@ int main(int argc, char* argv[]) {
     CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
 
     if (args.size() >= 4) {
+      db::StringTable strings(txn);
       if (args[3] == "node") {
         auto id = stol(args[4]);
         auto location = db::Locations(txn).get(id);
         cout << location.coords << endl;
-        auto tags = db::Elements(txn,"nodes").getReader(id).getRoot<Node>().getTags();
-        for (int i = 0; i < tags.size() / 2; i++) {
-          cout << tags[i*2].cStr() << "=" << tags[i*2+1].cStr() << "\n";
+        db::Elements nodes(txn,"nodes");
+        auto message = nodes.tryGet(id);
+        KJ_IF_MAYBE(reader, message) {
+          db::forEachTag(strings,reader->getRoot<Node>(),[](const char *key, const char *value) {
+            cout << key << "=" << value << "\n";
+          });
         }
       } else if (args[3] == "way") {
         db::Elements ways(txn,"ways");
-        auto message = ways.getReader(stol(args[4]));
-        auto way = message.getRoot<Way>();
-        for (auto node_id : way.getNodes()) {
-          cout << node_id << " ";
+        auto message = ways.tryGet(stol(args[4]));
+        KJ_IF_MAYBE(reader, message) {
+          auto way = reader->getRoot<Way>();
+          db::forEachNode(way,[](uint64_t node_id) {
+            cout << node_id << " ";
+          });
+          cout << endl;
+          db::forEachTag(strings,way,[](const char *key, const char *value) {
+            cout << key << "=" << value << " ";
+          });
+          cout << endl;
+        } else {
+          cout << "Not found" << endl;
         }
-        cout << endl;
-        auto tags = way.getTags();
-        for (int i = 0; i < tags.size() / 2; i++) {
-          cout << tags[i*2].cStr() << "=" << tags[i*2+1].cStr() << " ";
-        }
-        cout << endl;
       } else if (args[3] == "relation") {
         db::Elements relations(txn,"relations");
         uint64_t relation_id = stol(args[4]);
-        auto message = relations.getReader(relation_id);
-        auto relation = message.getRoot<Relation>();
-        auto tags = relation.getTags();
-        for (int i = 0; i < tags.size() / 2; i++) {
-          cout << tags[i*2].cStr() << "=" << tags[i*2+1].cStr() << " ";
-        }
-        auto members = relation.getMembers();
-        for (auto const &member : members) {
-          cout << member.getRef() << endl;
+        auto message = relations.tryGet(relation_id);
+        KJ_IF_MAYBE(reader, message) {
+          auto relation = reader->getRoot<Relation>();
+          db::forEachTag(strings,relation,[](const char *key, const char *value) {
+            cout << key << "=" << value << " ";
+          });
+          auto members = relation.getMembers();
+          for (auto const &member : members) {
+            cout << member.getRef() << endl;
+          }
+        } else {
+          cout << "Not found" << endl;
         }
       } else if (args[3] == "timestamp") {
         db::Metadata metadata(txn);
@@ -96,13 +130,12 @@ int main(int argc, char* argv[]) {
     } else {
       auto tables = {"locations","nodes","ways","relations","cell_node","node_way","node_relation","way_relation","relation_relation"};
       for (auto const &table : tables) {
-        MDB_dbi dbi;
-        CHECK(mdb_dbi_open(txn, table, MDB_INTEGERKEY, &dbi));
-        MDB_stat stat;
-        CHECK(mdb_stat(txn,dbi,&stat));
-        cout << table << ": " << stat.ms_entries << endl;
+        cout << table << ": " << db::tableEntries(txn,table) << endl;
       }
 
+      db::StringTable strings(txn);
+      if (!strings.empty()) cout << "strings: " << strings.size() << endl;
+
       db::Metadata metadata(txn);
       cout << "Timestamp: " << metadata.get("osmosis_replication_timestamp") << endl;
       cout << "Sequence #: " << metadata.get("osmosis_replication_sequence_number") << endl;
@@ -0,0 +1,112 @@
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include "cxxopts.hpp"
+#include "osmx/storage.h"
+
+using namespace std;
+using namespace osmx;
+
+// removes a file and the lock file LMDB creates next to it.
+static void removeEnv(const string &path) {
+  unlink(path.c_str());
+  unlink((path + "-lock").c_str());
+}
+
+// true if another process has the environment open.
+// LMDB holds a shared lock on the first byte of the lock file in every process that opened it,
+// and F_GETLK only reports locks of other processes, so the locks of this process don't count.
+static bool openElsewhere(const string &path) {
+  int fd = open((path + "-lock").c_str(),O_RDONLY);
+  if (fd < 0) {
+    perror("open");
+    exit(1);
+  }
+  struct flock lock;
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0;
+  lock.l_len = 1;
+  if (fcntl(fd,F_GETLK,&lock) != 0) {
+    perror("fcntl");
+    exit(1);
+  }
+  close(fd);
+  return lock.l_type != F_UNLCK;
+}
+
+void cmdCompact(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Compact", "Rewrite an .osmx file with its tables in key order.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("output", "Output .osmx", cxxopts::value<string>())
+    ("replace", "Replace the input with the compacted file")
+  ;
+  cmdoptions.parse_positional({"cmd","osmx","output"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  bool replace = result.count("replace") > 0;
+  if (result.count("osmx") == 0 || (result.count("output") == 0 && !replace)) {
+    cout << "Usage: osmx compact OSMX_FILE [OUTPUT_FILE] [OPTIONS]" << endl;
+    cout << "Rewrites every table in key order without free pages, restoring the sequential leaf layout of a fresh expand." << endl;
+    cout << "Run it in a window without updates. With --replace, every reader and writer of OSMX_FILE must be stopped first: it is only replaced if no other process has it open." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx compact planet.osmx --replace" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --replace: write to a temporary file and rename it over OSMX_FILE. OUTPUT_FILE is not needed." << endl;
+    exit(1);
+  }
+
+  string osmx = result["osmx"].as<string>();
+  string output = replace ? osmx + ".compact" : result["output"].as<string>();
+  removeEnv(output);
+
+  // writable with --replace, so the writer lock can be taken before the rename.
+  MDB_env* env = db::createEnv(osmx,replace);
+  // a process with the old file open would keep its meta pages in the shared lock file,
+  // and a waiting update would commit into the old file after the rename.
+  if (replace && openElsewhere(osmx)) {
+    mdb_env_close(env);
+    cout << "Another process has " << osmx << " open; stop every reader and writer before compact --replace." << endl;
+    exit(1);
+  }
+  MDB_envinfo before;
+  CHECK(mdb_env_info(env,&before));
+  {
+    Timer timer("compact");
+    CHECK(mdb_env_copy2(env,output.c_str(),MDB_CP_COMPACT));
+  }
+  struct stat input_stat, output_stat;
+  stat(osmx.c_str(),&input_stat);
+  stat(output.c_str(),&output_stat);
+  cout << "Compacted " << input_stat.st_size / 1000000.0 << " MB to " << output_stat.st_size / 1000000.0 << " MB" << endl;
+  if (!replace) {
+    mdb_env_close(env);
+    return;
+  }
+
+  // the write txn holds the writer lock, so no update can commit between the check and the rename.
+  MDB_txn *txn;
+  CHECK(mdb_txn_begin(env,NULL,0,&txn));
+  MDB_envinfo after;
+  CHECK(mdb_env_info(env,&after));
+  if (after.me_last_txnid != before.me_last_txnid || openElsewhere(osmx)) {
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+    cout << "Another process opened or updated " << osmx << " during compaction; it was not replaced." << endl;
+    removeEnv(output);
+    exit(1);
+  }
+  if (rename(output.c_str(),osmx.c_str()) != 0) {
+    perror("rename");
+    exit(1);
+  }
+  mdb_txn_abort(txn);
+  mdb_env_close(env);
+  // the lock file still describes the old file; LMDB creates a new one on the next open.
+  unlink((osmx + "-lock").c_str());
+  unlink((output + "-lock").c_str());
+}
@@ -1,10 +1,20 @@
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <set>
+#include <sstream>
 #include "osmium/handler.hpp"
 #include "osmium/visitor.hpp"
 #include "osmium/io/any_input.hpp"
 #include "osmium/util/progress_bar.hpp"
 #include "osmium/io/reader_with_progress_bar.hpp"
+#include "osmium/io/input_iterator.hpp"
+#include "osmium/thread/pool.hpp"
 #include "cxxopts.hpp"
 #include "kj/io.h"
 #include "capnp/message.h"
@@ -12,189 +22,166 @@
 #include "s2/s2latlng.h"
 #include "s2/s2cell_id.h"
 #include "osmx/storage.h"
+#include "osmx/sorter.h"
+#include "osmx/checkpoint.h"
+#include "osmx/metrics.h"
 #include "osmx/messages.capnp.h"
 
 using namespace std;
 using namespace osmx;
 
 
-typedef std::pair<uint64_t, uint64_t> Pair; 
-typedef std::pair<Pair, uint64_t> pqelem; 
-
-class SortReader {
+// counts tag keys, tag values and user names in a first pass over the input,
+// to choose the contents of the strings table.
+class StringCounter: public osmium::handler::Handler {
+  size_t MAX_CANDIDATES = 16000000;
   public:
-  SortReader(std::string filename) : mStream(filename, std::ios::in | std::ios::binary) { }
-
-  bool getNext() {
-    mStream.read((char *)&entry,sizeof(uint64_t) *2);
-    if (mStream.eof()) return false;
-    return true;
-  }
-
-  Pair entry;
-
-  private:
-  std::ifstream mStream;
-};
-
-class Sorter {
-int MAX_RUN_SIZE = 64000000; // about 1 GB
-public:
-  Sorter(std::string tempDir,std::string name) : mTempDir(tempDir), mName(name) { 
-    mStorage.reserve(MAX_RUN_SIZE);
-  }
-
-  void put(uint64_t from, uint64_t to) {
-    mStorage.push_back(std::make_pair(from,to));
-    if (mStorage.size() > MAX_RUN_SIZE) persist();
-  }
-
-  void put(S2CellId from, uint64_t to) {
-    put(from.id(),to);
-  }
-
-  void persist() {
-    if (mStorage.size() == 0) return;
-    sort(mStorage.begin(),mStorage.end());
-    int runNumber = mSavedRuns.size();
-    std::ofstream stream;
-    std::stringstream fname;
-    fname << mTempDir << "/" << std::setw(2) << std::setfill('0') << mName << "_" << std::setw(3) << std::setfill('0') << runNumber << ".run";
-    stream.open(fname.str(),std::ios::binary);
-    for (auto const &entry: mStorage) {
-      stream.write((char *)&entry.first,sizeof(uint64_t));
-      stream.write((char *)&entry.second,sizeof(uint64_t));
+  void osm_object(const osmium::OSMObject& object) {
+    count(object.user());
+    for (auto const &tag : object.tags()) {
+      count(tag.key());
+      count(tag.value());
     }
-    stream.close();
-    mStorage.clear();
-    mStorage.reserve(MAX_RUN_SIZE);
-    mSavedRuns.push_back(fname.str());
   }
 
-  void writeDb(MDB_env *env) {
-    persist();
-
-    Timer timer("External sort " + mName);
-    osmium::ProgressBar progress{MAX_RUN_SIZE * mSavedRuns.size(), osmium::isatty(2)};
-    int read = 0;
-    std::priority_queue<pqelem, std::vector<pqelem>, std::greater<pqelem>> q;
-    std::vector<SortReader> readers;
-    db::IndexWriter index(env,mName);
-
-    for (int i = 0; i < mSavedRuns.size(); i++) {
-      readers.emplace_back(mSavedRuns[i]);  
-      if (readers[i].getNext()) q.push(make_pair(readers[i].entry, i));
+  std::vector<std::string> mostFrequent(size_t n) {
+    std::vector<std::pair<uint64_t,std::string>> sorted;
+    sorted.reserve(mCounts.size());
+    for (auto const &entry : mCounts) {
+      // a string seen once is cheaper inline.
+      if (entry.second > 1) sorted.emplace_back(entry.second,entry.first);
     }
+    n = std::min(n,sorted.size());
+    std::partial_sort(sorted.begin(),sorted.begin() + n,sorted.end(),std::greater<std::pair<uint64_t,std::string>>());
+    std::vector<std::string> retval;
+    for (size_t i = 0; i < n; i++) retval.push_back(sorted[i].second);
+    return retval;
+  }
 
-    Pair last;
+  private:
+  void count(const char *str) {
+    mCounts[str]++;
+    if (mCounts.size() > MAX_CANDIDATES) prune();
+  }
 
-    while (q.size() > 0) {
-      pqelem pair = q.top();
-      auto idx = pair.second;
-      if (pair.first != last) {
-        if (pair.first.first != last.first) index.put(pair.first.first,pair.first.second,MDB_APPEND);
-        else index.put(pair.first.first,pair.first.second,MDB_APPENDDUP);
+  // unique strings like names and addresses would use unbounded memory,
+  // so drop the rarest candidates until the map is half full.
+  void prune() {
+    while (mCounts.size() > MAX_CANDIDATES / 2) {
+      mPruneBelow++;
+      for (auto it = mCounts.begin(); it != mCounts.end(); ) {
+        if (it->second < mPruneBelow) it = mCounts.erase(it);
+        else it++;
       }
-      q.pop();
-      if (readers[idx].getNext()) q.push(make_pair(readers[idx].entry, idx));
-      progress.update(read++);
-      last = pair.first;
-    }
-
-    index.commit();
-
-    progress.done();
-
-    for (auto const &run : mSavedRuns) {
-      remove(run.c_str());
     }
   }
 
-private:
-  Sorter( const Sorter& ) = delete;
-  Sorter& operator=( const Sorter& ) = delete;
-  std::vector<std::pair<uint64_t,uint64_t>> mStorage;
-  int mRunNumber = 0;
-  std::vector<std::string> mSavedRuns;
-  std::string mTempDir;
-  std::string mName;
+  std::unordered_map<std::string,uint64_t> mCounts;
+  uint64_t mPruneBelow = 1;
 };
 
 class Handler: public osmium::handler::Handler {
   public:
-  Handler(MDB_env *env, MDB_txn *txn,string tempDir) : 
+  Handler(MDB_env *env, db::Txn &txn,string tempDir, bool packNodes, uint64_t commitInterval, Checkpoint &checkpoint) : 
     mEnv(env),
     mTxn(txn),
-    mCellNode(tempDir,"cell_node"), 
+    mPackNodes(packNodes),
+    mCommitInterval(commitInterval),
+    mCheckpoint(checkpoint),
+    mStrings(txn),
+    mCellNode(tempDir,"cell_node",checkpoint.runs("cell_node")), 
     mLocations(txn), 
     mNodes(txn,"nodes"),
     mWays(txn,"ways"),
     mRelations(txn,"relations"),
-    mNodeWay(tempDir,"node_way"),
-    mNodeRelation(tempDir,"node_relation"),
-    mWayRelation(tempDir,"way_relation"),
-    mRelationRelation(tempDir,"relation_relation")
+    mNodeWay(tempDir,"node_way",checkpoint.runs("node_way")),
+    mNodeRelation(tempDir,"node_relation",checkpoint.runs("node_relation")),
+    mWayRelation(tempDir,"way_relation",checkpoint.runs("way_relation")),
+    mRelationRelation(tempDir,"relation_relation",checkpoint.runs("relation_relation")),
+    mTagIndex(txn)
   {
+    if (!checkpoint.empty() && !checkpoint.elementsDone()) {
+      // commits between checkpoints may have added elements whose index pairs were not saved, so they are added again.
+      mLocations.truncate(checkpoint.committed('n'));
+      mNodes.truncate(checkpoint.committed('n'));
+      mWays.truncate(checkpoint.committed('w'));
+      mRelations.truncate(checkpoint.committed('r'));
+      countCells();
+    }
   }
 
   ~Handler() {
-    CHECK(mdb_txn_commit(mTxn));
-    mCellNode.writeDb(mEnv);
-    mNodeWay.writeDb(mEnv);
-    mNodeRelation.writeDb(mEnv);
-    mWayRelation.writeDb(mEnv);
-    mRelationRelation.writeDb(mEnv);
+    if (!mCheckpoint.elementsDone()) {
+      db::CellCounts::create(mTxn,mCellCounts);
+      checkpoint('i',0);
+    }
+    mTxn.commit();
+    for (auto sorter : sorters()) {
+      if (mCheckpoint.finished(sorter->name())) continue;
+      sorter->writeDb(mEnv);
+      db::Txn txn(mEnv,true);
+      mCheckpoint.finish(sorter->name());
+      mCheckpoint.save(txn);
+      txn.commit();
+      sorter->removeRuns();
+    }
   }
 
   void node(const osmium::Node& node) {
+    if (mCheckpoint.skip('n',node.id())) return;
     mLocations.put(node.id(), db::Location{node.location(),(int32_t)node.version()},MDB_APPEND);
     auto loc = node.location();
     auto ll = S2LatLng::FromDegrees(loc.lat(),loc.lon());
     auto cell = S2CellId(ll).parent(CELL_INDEX_LEVEL);
     mCellNode.put(cell,node.id());
+    mCellCounts[cell.parent(CELL_COUNT_LEVEL).id()]++;
 
     if (node.tags().size() > 0) {
       ::capnp::MallocMessageBuilder message;
       Node::Builder nodeMsg = message.initRoot<Node>();
-      setTags<Node::Builder>(node.tags(),nodeMsg);
+      db::setTags<Node::Builder>(node.tags(),nodeMsg,mStrings);
       auto metadata = nodeMsg.initMetadata();
       metadata.setVersion(node.version());
       metadata.setTimestamp(node.timestamp().seconds_since_epoch());
       metadata.setChangeset(node.changeset());
       metadata.setUid(node.uid());
-      metadata.setUser(node.user());
+      db::setUser(metadata,node.user(),mStrings);
       kj::VectorOutputStream output;
       capnp::writeMessage(output,message);
       mNodes.put(node.id(),output,MDB_APPEND);
+      mTagIndex.add(osmium::item_type::node,node.tags(),node.id());
     }
+    written('n',node.id());
   }
 
   void way(const osmium::Way& way) {
+    if (mCheckpoint.skip('w',way.id())) return;
   	auto const &nodes = way.nodes();
     ::capnp::MallocMessageBuilder message;
     Way::Builder wayMsg = message.initRoot<Way>();
-    wayMsg.initNodes(nodes.size());
-    int i = 0;
-    for (int i = 0; i < nodes.size(); i++) {
-       wayMsg.getNodes().set(i,nodes[i].ref());
-       mNodeWay.put(nodes[i].ref(),way.id());
+    db::setNodes(wayMsg,nodes,mPackNodes);
+    for (auto const &node_ref : nodes) {
+       mNodeWay.put(node_ref.ref(),way.id());
     }
-    setTags<Way::Builder>(way.tags(),wayMsg);
+    db::setTags<Way::Builder>(way.tags(),wayMsg,mStrings);
     auto metadata = wayMsg.initMetadata();
     metadata.setVersion(way.version());
     metadata.setTimestamp(way.timestamp().seconds_since_epoch());
     metadata.setChangeset(way.changeset());
     metadata.setUid(way.uid());
-    metadata.setUser(way.user());
+    db::setUser(metadata,way.user(),mStrings);
     kj::VectorOutputStream output;
     capnp::writeMessage(output,message);
     mWays.put(way.id(),output,MDB_APPEND);
+    mTagIndex.add(osmium::item_type::way,way.tags(),way.id());
+    written('w',way.id());
   }
 
   void relation(const osmium::Relation& relation) {
+    if (mCheckpoint.skip('r',relation.id())) return;
     ::capnp::MallocMessageBuilder message;
     Relation::Builder relationMsg = message.initRoot<Relation>();
-    setTags<Relation::Builder>(relation.tags(),relationMsg);
+    db::setTags<Relation::Builder>(relation.tags(),relationMsg,mStrings);
     auto members = relationMsg.initMembers(relation.members().size());
     int i = 0;
     for (auto const &member : relation.members()) {
@@ -219,16 +206,72 @@ class Handler: public osmium::handler::Handler {
     metadata.setTimestamp(relation.timestamp().seconds_since_epoch());
     metadata.setChangeset(relation.changeset());
     metadata.setUid(relation.uid());
-    metadata.setUser(relation.user());
+    db::setUser(metadata,relation.user(),mStrings);
     kj::VectorOutputStream output;
     capnp::writeMessage(output,message);
     mRelations.put(relation.id(),output,MDB_APPEND);
+    mTagIndex.add(osmium::item_type::relation,relation.tags(),relation.id());
+    written('r',relation.id());
   }
 
   private:
+  // commits every mCommitInterval elements, like IndexWriter, so one txn never holds the dirty pages of the whole input.
+  // the tables are appended in id order, so each commit only adds pages at the end of each B-tree.
+  // every checkpoint writes a sort run per index, so checkpoints are only taken with a commit every CHECKPOINT_SECONDS.
+  void written(char type, uint64_t id) {
+    // without --commit-interval the tag index would otherwise buffer every tagged element until the end.
+    if (mTagIndex.buffered() >= TAG_INDEX_FLUSH) mTagIndex.flush();
+    if (mCommitInterval == 0 || ++mWrites < mCommitInterval) return;
+    if (chrono::steady_clock::now() - mLastCheckpoint >= chrono::seconds(CHECKPOINT_SECONDS)) checkpoint(type,id);
+    mTxn.restart();
+    mStrings.setTxn(mTxn);
+    mLocations.setTxn(mTxn);
+    mNodes.setTxn(mTxn);
+    mWays.setTxn(mTxn);
+    mRelations.setTxn(mTxn);
+    mTagIndex.setTxn(mTxn);
+    mWrites = 0;
+  }
+
+  // saves the sort runs and the tag index with the elements up to id, so --resume can skip them.
+  void checkpoint(char type, uint64_t id) {
+    for (auto sorter : sorters()) {
+      sorter->persist();
+      mCheckpoint.setRuns(sorter->name(),sorter->runs());
+    }
+    mTagIndex.flush();
+    mCheckpoint.set(type,id);
+    mCheckpoint.save(mTxn);
+    mLastCheckpoint = chrono::steady_clock::now();
+  }
+
+  // the cell counts are only kept in memory until the end, so a resumed expand counts the committed nodes again.
+  void countCells() {
+    db::LocationCursor locations(mTxn);
+    uint64_t id;
+    db::Location location;
+    while (locations.next(id,location)) {
+      auto cell = S2CellId(S2LatLng::FromDegrees(location.coords.lat(),location.coords.lon())).parent(CELL_COUNT_LEVEL);
+      mCellCounts[cell.id()]++;
+    }
+  }
+
+  vector<Sorter *> sorters() {
+    return {&mCellNode,&mNodeWay,&mNodeRelation,&mWayRelation,&mRelationRelation};
+  }
+
   MDB_env* mEnv;
-  MDB_txn* mTxn;
+  db::Txn &mTxn;
+  bool mPackNodes;
+  uint64_t mCommitInterval;
+  uint64_t mWrites = 0;
+  uint64_t TAG_INDEX_FLUSH = 16000000;
+  int CHECKPOINT_SECONDS = 1800;
+  chrono::steady_clock::time_point mLastCheckpoint = chrono::steady_clock::now();
+  Checkpoint &mCheckpoint;
+  db::StringTable mStrings;
   Sorter mCellNode;
+  std::unordered_map<uint64_t,uint64_t> mCellCounts;
   db::Locations mLocations;
 
   db::Elements mNodes;
@@ -239,60 +282,355 @@ class Handler: public osmium::handler::Handler {
   Sorter mNodeRelation;
   Sorter mWayRelation;
   Sorter mRelationRelation;
+  db::TagIndex mTagIndex;
+};
+
+// the cell of an element: its location for a node, the first node for a way,
+// and the first node or way member for a relation.
+class ClusterCells {
+  public:
+  ClusterCells(MDB_txn *txn) : mLocations(txn), mWays(txn,"ways") { }
+
+  S2CellId node(uint64_t id) {
+    auto location = mLocations.get(id);
+    if (location.is_undefined()) return S2CellId::None();
+    return S2CellId(S2LatLng::FromDegrees(location.coords.lat(),location.coords.lon()));
+  }
+
+  S2CellId way(Way::Reader way) {
+    S2CellId cell = S2CellId::None();
+    db::forEachNode(way,[&](uint64_t node_id) {
+      if (!cell.is_valid()) cell = node(node_id);
+    });
+    return cell;
+  }
+
+  S2CellId relation(Relation::Reader relation) {
+    for (auto const &member : relation.getMembers()) {
+      S2CellId cell = S2CellId::None();
+      if (member.getType() == RelationMember::Type::NODE) {
+        cell = node(member.getRef());
+      } else if (member.getType() == RelationMember::Type::WAY) {
+        auto maybe_reader = mWays.tryGet(member.getRef());
+        KJ_IF_MAYBE(reader, maybe_reader) {
+          cell = way(reader->getRoot<Way>());
+        }
+      }
+      if (cell.is_valid()) return cell;
+    }
+    return S2CellId::None();
+  }
+
+  private:
+  db::Locations mLocations;
+  db::Elements mWays;
 };
 
+// rewrites an element table in the order of the cell of each element,
+// so that elements that are close together are also close together in the file.
+// the table is emptied, and NAME_position and NAME_clustered are used instead.
+// the pages of the emptied table stay in the file as free pages, so the file holds the element data about twice.
+void cluster(MDB_env *env, const string &tempDir, const string &name, Checkpoint &checkpoint) {
+  if (checkpoint.finished("cluster_" + name)) return;
+  Timer timer("cluster " + name);
+  db::Txn txn(env,true);
+  {
+    db::Elements elements(txn,name);
+    ClusterCells cells(txn);
+    Sorter sorter(tempDir,name + "_clustered",0);
+    // ids are read through their own cursor, since lookups would move it.
+    db::ElementCursor ids(txn,name);
+    db::ClusterWriter writer(txn,name);
+
+    uint64_t id;
+    while (ids.next(id)) {
+      S2CellId cell;
+      if (name == "nodes") {
+        cell = cells.node(id);
+      } else {
+        auto reader = elements.getReader(id);
+        if (name == "ways") cell = cells.way(reader.getRoot<Way>());
+        else cell = cells.relation(reader.getRoot<Relation>());
+      }
+      uint64_t position = db::clusterPosition(cell,id);
+      writer.putPosition(id,position);
+      sorter.put(position,id);
+    }
+
+    sorter.merge([&](uint64_t position, uint64_t id) {
+      writer.copy(position,id);
+    });
+
+    writer.dropSource();
+    checkpoint.finish("cluster_" + name);
+    checkpoint.save(txn);
+  }
+  txn.commit();
+}
+
+// applies the handler to each buffer as it is decoded, timing how long the handler waits for the reader.
+// a wait close to the insert time means decoding is the limit, and more --threads would help.
+template <typename TReader, typename THandler>
+void applyTimed(TReader &reader, THandler &handler, Metrics &metrics) {
+  double wait = 0;
+  while (true) {
+    auto start = chrono::high_resolution_clock::now();
+    osmium::memory::Buffer buffer = reader.read();
+    wait += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    if (!buffer) break;
+    osmium::apply(buffer, handler);
+  }
+  progress() << "Read wait: " << wait << "s" << endl;
+  metrics.phase("read_wait",wait,0);
+}
+
+// merges inputs that are each sorted by type and id into one sorted stream, without writing a merged file first.
+// an object in more than one input, like a node on the border of two regions, is applied once at its highest version.
+class MergedInput {
+  typedef osmium::io::InputIterator<osmium::io::Reader,osmium::OSMObject> Iterator;
+
+  public:
+  MergedInput(const vector<osmium::io::File> &files, osmium::thread::Pool &pool) {
+    for (auto const &file : files) {
+      mReaders.emplace_back(new osmium::io::Reader(file, osmium::osm_entity_bits::object, pool));
+      mIterators.emplace_back(*mReaders.back());
+    }
+  }
+
+  osmium::io::Header header() {
+    return mReaders[0]->header();
+  }
+
+  template <typename THandler>
+  void apply(THandler &handler) {
+    auto greater = [&](size_t a, size_t b) { return before(*mIterators[b],*mIterators[a]); };
+    priority_queue<size_t,vector<size_t>,decltype(greater)> queue(greater);
+    for (size_t i = 0; i < mIterators.size(); i++) {
+      if (mIterators[i] != Iterator{}) queue.push(i);
+    }
+
+    osmium::item_type lastType = osmium::item_type::undefined;
+    osmium::object_id_type lastId = 0;
+    while (!queue.empty()) {
+      size_t i = queue.top();
+      queue.pop();
+      const osmium::OSMObject &object = *mIterators[i];
+      if (object.type() != lastType || object.id() != lastId) {
+        lastType = object.type();
+        lastId = object.id();
+        osmium::apply_item(object, handler);
+      }
+      if (++mIterators[i] != Iterator{}) queue.push(i);
+    }
+  }
+
+  void close() {
+    for (auto &reader : mReaders) reader->close();
+  }
+
+  private:
+  // by type, then id, then the highest version first.
+  static bool before(const osmium::OSMObject &a, const osmium::OSMObject &b) {
+    if (a.type() != b.type()) return a.type() < b.type();
+    if (a.id() != b.id()) return a.id() < b.id();
+    return a.version() > b.version();
+  }
+
+  vector<unique_ptr<osmium::io::Reader>> mReaders;
+  vector<Iterator> mIterators;
+};
+
+// "-" is stdin, which has no file name to detect the format from.
+osmium::io::File inputFile(const string &path, const string &format) {
+  if (path == "-") return osmium::io::File{path, format.empty() ? "pbf" : format};
+  return osmium::io::File{path, format};
+}
+
 void cmdExpand(int argc, char* argv[]) {
   cxxopts::Options options("Expand", "Expand a a .osm.pbf into an .osmx file");
   options.add_options()
     ("v,verbose", "Verbose output")
+    ("quiet", "Don't print progress")
     ("cmd", "Command to run", cxxopts::value<string>())
-    ("input", "Input .pbf", cxxopts::value<string>())
-    ("output", "Output .osmx", cxxopts::value<string>())
+    ("files", "Input .pbf files and output .osmx", cxxopts::value<vector<string>>())
+    ("input-format", "Format of the input, such as pbf or osm", cxxopts::value<string>())
+    ("dictionary", "Store the N most frequent strings in a table", cxxopts::value<int>())
+    ("pack-nodes", "Store way node ids as varint deltas")
+    ("compress", "Store elements in the capnp packed encoding")
+    ("cluster", "Store elements in spatial order")
+    ("tag-index", "Index the ids of objects by tag for these keys", cxxopts::value<vector<string>>())
+    ("commit-interval", "Commit every N elements", cxxopts::value<uint64_t>())
+    ("writemap", "Write through a writable memory map")
+    ("threads", "Decode the input with N threads", cxxopts::value<int>())
+    ("queue-size", "Keep up to N buffers in flight between reading, decoding and inserting", cxxopts::value<int>())
+    ("resume", "Continue an interrupted expand from its last checkpoint")
+    ("metrics", "Write metrics to this file", cxxopts::value<string>())
   ;
-  options.parse_positional({"cmd","input", "output"});
+  options.parse_positional({"cmd","files"});
   auto result = options.parse(argc, argv);
 
-  if (result.count("input") == 0 || result.count("output") == 0) {
-    cout << "Usage: osmx expand OSM_FILE OSMX_FILE [OPTIONS]" << endl << endl;
-    cout << "OSM_FILE must be an OSM XML or PBF." << endl << endl;
-    cout << "EXAMPLE:" << endl;
-    cout << " osmx expand planet_latest.osm.pbf planet.osmx" << endl << endl;
+  if (result.count("files") < 2) {
+    cout << "Usage: osmx expand OSM_FILE [OSM_FILE...] OSMX_FILE [OPTIONS]" << endl << endl;
+    cout << "OSM_FILE must be an OSM XML or PBF, or - for stdin." << endl;
+    cout << "Several OSM_FILEs, each sorted by type and id, are merged as they are read." << endl << endl;
+    cout << "EXAMPLES:" << endl;
+    cout << " osmx expand planet_latest.osm.pbf planet.osmx" << endl;
+    cout << " osmx expand europe.osm.pbf asia.osm.pbf eurasia.osmx" << endl;
+    cout << " curl -s https://planet.osm.org/pbf/planet-latest.osm.pbf | osmx expand - planet.osmx" << endl << endl;
     cout << "OPTIONS:" << endl;
     cout << " --v,--verbose: verbose output." << endl;
+    cout << " --quiet: don't print progress, only errors." << endl;
+    cout << " --input-format FORMAT: the format of the input, such as pbf or osm. The default for stdin is pbf." << endl;
+    cout << " --dictionary N: encode the N most frequent tag keys, values and user names as integers." << endl;
+    cout << " --pack-nodes: store the node ids of ways as zigzag varint deltas instead of 64 bit integers." << endl;
+    cout << " --compress: store nodes, ways and relations in the capnp packed encoding. Smaller, but every read is a copy." << endl;
+    cout << " --cluster: store nodes, ways and relations in S2 cell order, so regional extracts read fewer pages. Run osmx compact afterwards to shrink the file." << endl;
+    cout << " --commit-interval N: commit every N nodes, ways and relations instead of once, which bounds the memory held by dirty pages. 8000000 is a good value for the planet." << endl;
+    cout << " --resume: continue an interrupted expand of the same input from its last checkpoint. Checkpoints are written with a --commit-interval commit every 30 minutes, and after each index. Not with --writemap." << endl;
+    cout << " --threads N: decode the input with N threads. The default is the number of cores, or OSMIUM_POOL_THREADS." << endl;
+    cout << " --queue-size N: the number of buffers read ahead of decoding, and decoded ahead of inserting. The default is 20." << endl;
+    cout << " --writemap: write pages directly into a writable memory map instead of copying them from malloc'd buffers. The file is sparse at the 2 TB map size until compacted." << endl;
+    cout << " --tag-index KEY[,KEY...]: index the ids of objects by tag value for these keys, for fast extract --tags queries." << endl;
+    cout << " --metrics FILE: write phase timings and table sizes as JSON, or Prometheus text if FILE ends in .prom; - for stdout." << endl;
     exit(1);
   }
 
-  string input =result["input"].as<string>();
-  string output = result["output"].as<string>();
+  auto files = result["files"].as<vector<string>>();
+  string output = files.back();
+  vector<string> inputs(files.begin(),files.end() - 1);
+  bool fromStdin = find(inputs.begin(),inputs.end(),"-") != inputs.end();
+  if (fromStdin && inputs.size() > 1) {
+    cout << "stdin can't be merged with other inputs." << endl;
+    exit(1);
+  }
+  if (fromStdin && result.count("dictionary")) {
+    cout << "--dictionary needs a second pass over the input, so it can't read stdin." << endl;
+    exit(1);
+  }
 
+  if (result.count("quiet")) quiet() = true;
   Timer timer("convert");
-  MDB_env* env = db::createEnv(output,true);
-  MDB_txn* txn;
-  CHECK(mdb_txn_begin(env, NULL, 0, &txn));
+  Metrics metrics("expand");
+  // MDB_MAPASYNC: with a write map, commits don't wait for the map to be flushed; the file is synced once at the end.
+  bool writemap = result.count("writemap") > 0;
+  db::Env env(output,true,writemap ? MDB_WRITEMAP | MDB_MAPASYNC : 0);
+  db::Txn txn(env,true);
+  uint64_t commitInterval = result.count("commit-interval") ? result["commit-interval"].as<uint64_t>() : 0;
+
+  string tempDir = output + "-temp";
+  bool resume = result.count("resume") > 0;
+  if (resume && writemap) {
+    cout << "--resume can't be used with --writemap: with MDB_MAPASYNC a system crash can leave the file corrupt." << endl;
+    exit(1);
+  }
+  Checkpoint checkpoint;
+  if (resume) {
+    checkpoint = Checkpoint(db::Metadata(txn).get("expand_checkpoint"));
+    if (checkpoint.empty()) {
+      cout << output << " has no checkpoint to resume from." << endl;
+      exit(1);
+    }
+  } else if (mkdir(tempDir.c_str(),S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) != 0) {
+    cout << tempDir << " exists: resume the interrupted expand with --resume, or remove it and " << output << "." << endl;
+    exit(1);
+  }
+
+  string format = result.count("input-format") ? result["input-format"].as<string>() : "";
+  vector<osmium::io::File> inputFiles;
+  for (auto const &input : inputs) inputFiles.push_back(inputFile(input,format));
+
+  // the reader reads the file in its own thread and decodes blocks in the pool, so both overlap with inserting.
+  // libosmium sizes the queues between them from the environment when the reader is created.
+  if (result.count("queue-size")) {
+    string queueSize = to_string(result["queue-size"].as<int>());
+    setenv("OSMIUM_MAX_INPUT_QUEUE_SIZE",queueSize.c_str(),1);
+    setenv("OSMIUM_MAX_OSMDATA_QUEUE_SIZE",queueSize.c_str(),1);
+  }
+  osmium::thread::Pool pool{result.count("threads") ? result["threads"].as<int>() : 0};
+
+  // the strings table is committed with the first commit.
+  if (result.count("dictionary") && !resume) {
+    Timer dictionary("dictionary");
+    Phase phase(metrics,"dictionary");
+    StringCounter counter;
+    for (auto const &input_file : inputFiles) {
+      osmium::io::ReaderWithProgressBar counter_reader{!quiet(), input_file, osmium::osm_entity_bits::object, pool};
+      osmium::apply(counter_reader, counter);
+      counter_reader.close();
+    }
+    auto strings = counter.mostFrequent(result["dictionary"].as<int>());
+    progress() << "Strings: " << strings.size() << endl;
+    db::StringTable::create(txn,strings);
+  }
 
-  const osmium::io::File input_file{input};
-  osmium::io::ReaderWithProgressBar reader{true, input_file, osmium::osm_entity_bits::object};
+  // a single input is read buffer by buffer; several are merged object by object.
+  unique_ptr<osmium::io::ReaderWithProgressBar> reader;
+  unique_ptr<MergedInput> merged;
+  osmium::io::Header header;
+  if (inputFiles.size() == 1) {
+    reader.reset(new osmium::io::ReaderWithProgressBar{!quiet(), inputFiles[0], osmium::osm_entity_bits::object, pool});
+    header = reader->header();
+  } else {
+    merged.reset(new MergedInput(inputFiles,pool));
+    header = merged->header();
+  }
 
   db::Metadata metadata(txn);
-  auto header = reader.header();
 
   for (auto option : header) {
-    cout << option.first << " " << option.second << endl;
+    progress() << option.first << " " << option.second << endl;
   }
-  cout << "Box: " << header.box() << endl;
-  cout << "Timestamp: " << header.get("osmosis_replication_timestamp") << endl;
-  cout << "Sequence#: " << header.get("osmosis_replication_sequence_number") << endl;
+  progress() << "Box: " << header.box() << endl;
+  progress() << "Timestamp: " << header.get("osmosis_replication_timestamp") << endl;
+  progress() << "Sequence#: " << header.get("osmosis_replication_sequence_number") << endl;
   metadata.put("osmosis_replication_timestamp",header.get("osmosis_replication_timestamp"));
   metadata.put("osmosis_replication_sequence_number",header.get("osmosis_replication_sequence_number"));
-  metadata.put("import_filename",input);
-  string tempDir = output + "-temp";
-  assert(mkdir(tempDir.c_str(),S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == 0);
+  string importFilename;
+  for (auto const &input : inputs) importFilename += (importFilename.empty() ? "" : ",") + input;
+  metadata.put("import_filename",importFilename);
+  // a resumed expand keeps the encoding options of the interrupted one.
+  if (!resume) {
+    if (result.count("pack-nodes")) metadata.put("way_nodes","packed");
+    if (result.count("compress")) metadata.put("element_encoding","packed");
+    if (result.count("tag-index")) db::TagIndex::create(txn,result["tag-index"].as<vector<string>>());
+  }
+  bool packNodes = metadata.get("way_nodes") == "packed";
 
   {
     Timer insert("insert");
-    Handler handler(env,txn,tempDir);
-    osmium::apply(reader, handler);
+    Phase phase(metrics,"insert");
+    Handler handler(env,txn,tempDir,packNodes,commitInterval,checkpoint);
+    if (reader) {
+      if (!checkpoint.elementsDone()) applyTimed(*reader, handler, metrics);
+      reader->close();
+    } else {
+      if (!checkpoint.elementsDone()) merged->apply(handler);
+      merged->close();
+    }
+  }
+
+  if (result.count("cluster")) {
+    Phase phase(metrics,"cluster");
+    // relations are placed using their member ways, which are quicker to look up before the ways are clustered.
+    cluster(env,tempDir,"relations",checkpoint);
+    cluster(env,tempDir,"ways",checkpoint);
+    cluster(env,tempDir,"nodes",checkpoint);
   }
 
-  assert(rmdir(tempDir.c_str()) == 0);
+  if (rmdir(tempDir.c_str()) != 0) {
+    perror(tempDir.c_str());
+    exit(1);
+  }
+  {
+    db::Txn write(env,true);
+    db::Metadata(write).put("expand_checkpoint","");
+    write.commit();
+  }
+
+  if (result.count("metrics")) {
+    db::Txn read(env);
+    metrics.lmdb(env,read);
+    metrics.write(result["metrics"].as<string>());
+  }
+  env.sync();
 }
@@ -0,0 +1,389 @@
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unordered_map>
+#include "s2/s2region_coverer.h"
+#include "osmium/area/assembler.hpp"
+#include "osmium/geom/geojson.hpp"
+#include "osmium/geom/wkb.hpp"
+#include "osmium/memory/buffer.hpp"
+#include "cxxopts.hpp"
+#include "nlohmann/json.hpp"
+#include "osmx/storage.h"
+#include "osmx/region.h"
+#include "osmx/builder.h"
+#include "osmx/metrics.h"
+
+using namespace std;
+using namespace osmx;
+
+// ways are read and their node locations looked up in batches of this many, in node id order.
+static const size_t WAY_BATCH = 8192;
+static const size_t RELATION_CHUNK = 16384;
+
+enum class ExportFormat { GeoJSONSeq, WKB };
+
+// turns osmium objects with locations into output lines.
+// GeoJSONSeq is one GeoJSON Feature per line.
+// WKB is tab separated osm type, id, hex WKB and tags as JSON, which PostgreSQL COPY loads directly.
+class FeatureWriter {
+  public:
+  FeatureWriter(ExportFormat format) : mFormat(format), mWkb(osmium::geom::wkb_type::wkb,osmium::geom::out_type::hex) { }
+
+  bool node(string &out, const osmium::Node &node) {
+    return feature(out,"node",node.id(),node.tags(),[&](bool json) {
+      return json ? mGeoJSON.create_point(node.location()) : mWkb.create_point(node.location());
+    });
+  }
+
+  bool way(string &out, const osmium::Way &way) {
+    return feature(out,"way",way.id(),way.tags(),[&](bool json) {
+      return json ? mGeoJSON.create_linestring(way.nodes()) : mWkb.create_linestring(way.nodes());
+    });
+  }
+
+  bool area(string &out, const osmium::Area &area) {
+    return feature(out,"relation",area.orig_id(),area.tags(),[&](bool json) {
+      return json ? mGeoJSON.create_multipolygon(area) : mWkb.create_multipolygon(area);
+    });
+  }
+
+  private:
+  // false if the geometry can't be made, such as a way with one distinct location.
+  template <typename F>
+  bool feature(string &out, const char *type, osmium::object_id_type id, const osmium::TagList &tags, F geometry) {
+    string geom;
+    try {
+      geom = geometry(mFormat == ExportFormat::GeoJSONSeq);
+    } catch (const osmium::geometry_error &) {
+      return false;
+    } catch (const osmium::invalid_location &) {
+      return false;
+    }
+
+    nlohmann::json properties = nlohmann::json::object();
+    for (auto const &tag : tags) properties[tag.key()] = tag.value();
+
+    if (mFormat == ExportFormat::GeoJSONSeq) {
+      properties["@type"] = type;
+      properties["@id"] = id;
+      out += "{\"type\":\"Feature\",\"properties\":";
+      out += properties.dump();
+      out += ",\"geometry\":";
+      out += geom;
+      out += "}\n";
+    } else {
+      // COPY text format treats backslashes as escapes.
+      string json = properties.dump();
+      string escaped;
+      for (char c : json) {
+        if (c == '\\') escaped += '\\';
+        escaped += c;
+      }
+      out += type;
+      out += '\t';
+      out += to_string(id);
+      out += '\t';
+      out += geom;
+      out += '\t';
+      out += escaped;
+      out += '\n';
+    }
+    return true;
+  }
+
+  ExportFormat mFormat;
+  osmium::geom::GeoJSONFactory<> mGeoJSON;
+  osmium::geom::WKBFactory<> mWkb;
+};
+
+// sets the locations of all way nodes in buffer, looking up each distinct node once in id order.
+static void setLocations(const db::Locations &locations, osmium::memory::Buffer &buffer) {
+  vector<uint64_t> node_ids;
+  for (auto const &way : buffer.select<osmium::Way>()) {
+    for (auto const &node_ref : way.nodes()) node_ids.push_back(node_ref.ref());
+  }
+  std::sort(node_ids.begin(),node_ids.end());
+  node_ids.erase(std::unique(node_ids.begin(),node_ids.end()),node_ids.end());
+
+  std::unordered_map<uint64_t,osmium::Location> found;
+  found.reserve(node_ids.size());
+  for (auto node_id : node_ids) found[node_id] = locations.get(node_id).coords;
+
+  for (auto &way : buffer.select<osmium::Way>()) {
+    for (auto &node_ref : way.nodes()) node_ref.set_location(found[node_ref.ref()]);
+  }
+}
+
+static bool isArea(const osmium::Relation &relation) {
+  const char *type = relation.tags()["type"];
+  return type && (!strcmp(type,"multipolygon") || !strcmp(type,"boundary"));
+}
+
+// assembles multipolygon relations with osmium's area assembler, in its own thread.
+// the thread, its read txn and its builders are kept for the whole export, and given one slice of relations at a time.
+// LMDB ties a read txn to the thread that began it, so the txn is begun in the thread.
+class RelationWorker {
+  public:
+  RelationWorker(MDB_env *env, ExportFormat format) : mEnv(env), mFormat(format), mThread(&RelationWorker::run,this) { }
+
+  ~RelationWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mDone = true;
+    }
+    mCond.notify_all();
+    mThread.join();
+  }
+
+  void start(vector<uint64_t> ids) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mIds = std::move(ids);
+      mOut.clear();
+      mFeatures = 0;
+      mPending = true;
+    }
+    mCond.notify_all();
+  }
+
+  // waits for the slice given to start, and appends its output.
+  void finish(ofstream &out, uint64_t &features) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCond.wait(lock,[&]() { return !mPending; });
+    out << mOut;
+    features += mFeatures;
+  }
+
+  private:
+  void run() {
+    db::Txn txn(mEnv);
+    ObjectBuilder builder(txn,false);
+    db::LocationCursor locations(txn);
+    FeatureWriter writer(mFormat);
+    osmium::area::AssemblerConfig config;
+    osmium::area::Assembler assembler{config};
+    osmium::memory::Buffer relation_buffer{1024,osmium::memory::Buffer::auto_grow::yes};
+    osmium::memory::Buffer way_buffer{1024,osmium::memory::Buffer::auto_grow::yes};
+    osmium::memory::Buffer area_buffer{1024,osmium::memory::Buffer::auto_grow::yes};
+    vector<size_t> offsets;
+    vector<const osmium::Way *> ways;
+
+    while (true) {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCond.wait(lock,[&]() { return mPending || mDone; });
+      if (!mPending) return;
+      lock.unlock();
+
+      for (auto relation_id : mIds) {
+        relation_buffer.clear();
+        if (!builder.relation(relation_buffer,relation_id)) continue;
+        relation_buffer.commit();
+        auto &relation = relation_buffer.get<osmium::Relation>(0);
+        if (!isArea(relation)) continue;
+
+        // the assembler skips members with ref 0, and expects one way for every other member.
+        way_buffer.clear();
+        offsets.clear();
+        for (auto &member : relation.members()) {
+          if (member.type() == osmium::item_type::way && builder.way(way_buffer,member.ref())) {
+            offsets.push_back(way_buffer.commit());
+          } else {
+            member.set_ref(0);
+          }
+        }
+        if (offsets.empty()) continue;
+        setLocations(locations,way_buffer);
+        ways.clear();
+        for (auto offset : offsets) ways.push_back(&way_buffer.get<osmium::Way>(offset));
+
+        area_buffer.clear();
+        if (!assembler(relation,ways,area_buffer)) continue;
+        for (auto const &area : area_buffer.select<osmium::Area>()) {
+          if (writer.area(mOut,area)) mFeatures++;
+        }
+      }
+
+      lock.lock();
+      mPending = false;
+      lock.unlock();
+      mCond.notify_all();
+    }
+  }
+
+  MDB_env *mEnv;
+  ExportFormat mFormat;
+  std::mutex mMutex;
+  std::condition_variable mCond;
+  vector<uint64_t> mIds;
+  string mOut;
+  uint64_t mFeatures = 0;
+  bool mPending = false;
+  bool mDone = false;
+  // last, so the thread starts after the other members are initialized.
+  std::thread mThread;
+};
+
+void cmdExport(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Export", "Write the features in a region as GeoJSON or WKB.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("output", "Output file", cxxopts::value<string>())
+    ("format", "geojsonseq or wkb", cxxopts::value<string>()->default_value("geojsonseq"))
+    ("threads", "Threads for assembling multipolygons", cxxopts::value<int>())
+    ("bbox", "rectangle in minLat,minLon,maxLat,maxLon", cxxopts::value<string>())
+    ("disc", "disc in centerLat,centerLon,radiusDegrees", cxxopts::value<string>())
+    ("geojson","geoJson of region", cxxopts::value<string>())
+    ("poly","osmosis .poly of region", cxxopts::value<string>())
+    ("region","file for region with extension .bbox, .disc, .json or .poly", cxxopts::value<string>())
+    ("metrics","write metrics to this file",cxxopts::value<string>())
+  ;
+  cmdoptions.parse_positional({"cmd","osmx","output"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  std::unique_ptr<Region> region;
+  if (result.count("bbox")) region = std::make_unique<Region>(result["bbox"].as<string>(),"bbox");
+  else if (result.count("disc")) region = std::make_unique<Region>(result["disc"].as<string>(),"disc");
+  else if (result.count("geojson")) region = std::make_unique<Region>(result["geojson"].as<string>(),"geojson");
+  else if (result.count("poly")) region = std::make_unique<Region>(result["poly"].as<string>(),"poly");
+  else if (result.count("region")) region = Region::FromFile(result["region"].as<string>());
+
+  auto format_name = result["format"].as<string>();
+  if (result.count("osmx") == 0 || result.count("output") == 0 || !region || (format_name != "geojsonseq" && format_name != "wkb")) {
+    cout << "Usage: osmx export OSMX_FILE OUTPUT_FILE [OPTIONS]" << endl;
+    cout << "Writes the tagged nodes, ways and multipolygon relations in a region as geometries." << endl;
+    cout << "Nodes are points, ways are linestrings, and relations with type=multipolygon or type=boundary are assembled into multipolygons." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx export planet.osmx manhattan.geojsonseq --region manhattan.json" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --format geojsonseq: one GeoJSON Feature per line, with tags, @type and @id as properties. This is the default." << endl;
+    cout << " --format wkb: tab separated type, id, hex WKB and tags as JSON, for PostgreSQL COPY." << endl;
+    cout << " --threads N: assemble multipolygons in N threads. Defaults to the number of cores, and is at most one less than the LMDB reader limit." << endl;
+    cout << " --bbox, --disc, --geojson, --poly, --region: the region, as for osmx extract." << endl;
+    cout << " --metrics FILE: write phase timings and counts as JSON, or Prometheus text if FILE ends in .prom; - for stdout." << endl;
+    exit(1);
+  }
+  ExportFormat format = format_name == "wkb" ? ExportFormat::WKB : ExportFormat::GeoJSONSeq;
+  int threads = result.count("threads") ? std::max(1,result["threads"].as<int>()) : std::max(1u,std::thread::hardware_concurrency());
+  Metrics metrics("export");
+
+  db::Env env(result["osmx"].as<string>());
+  db::Txn txn(env);
+  // every worker holds a read txn, and so does this thread.
+  unsigned int maxreaders;
+  CHECK(mdb_env_get_maxreaders(env,&maxreaders));
+  threads = std::min(threads,(int)maxreaders - 1);
+
+  Roaring64Map node_ids;
+  Roaring64Map way_ids;
+  Roaring64Map relation_ids;
+  {
+    Phase phase(metrics,"cell_scan");
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1024);
+    options.set_max_level(CELL_INDEX_LEVEL);
+    S2RegionCoverer coverer(options);
+    S2CellUnion covering = region->GetCovering(coverer);
+
+    db::IndexCursor cell_node(txn,"cell_node");
+    for (auto cell_id : covering.cell_ids()) cell_node.traverseCell(cell_id,node_ids);
+  }
+  {
+    Phase phase(metrics,"reverse_lookup");
+    db::IndexCursor node_way(txn,"node_way");
+    db::IndexCursor node_relation(txn,"node_relation");
+    db::IndexCursor way_relation(txn,"way_relation");
+    for (auto node_id : node_ids) {
+      node_way.traverseReverse(node_id,way_ids);
+      node_relation.traverseReverse(node_id,relation_ids);
+    }
+    for (auto way_id : way_ids) way_relation.traverseReverse(way_id,relation_ids);
+  }
+
+  ofstream out(result["output"].as<string>());
+  uint64_t features = 0;
+  {
+    Phase phase(metrics,"nodes");
+    ObjectBuilder builder(txn,false);
+    FeatureWriter writer(format);
+    string lines;
+    osmium::memory::Buffer buffer{256,osmium::memory::Buffer::auto_grow::yes};
+    for (auto node_id : node_ids) {
+      buffer.clear();
+      if (!builder.node(buffer,node_id)) continue;
+      buffer.commit();
+      // untagged nodes are only parts of ways, not features.
+      auto const &node = buffer.get<osmium::Node>(0);
+      if (node.tags().empty()) continue;
+      if (writer.node(lines,node)) features++;
+      if (lines.size() > 1 << 20) {
+        out << lines;
+        lines.clear();
+      }
+    }
+    out << lines;
+  }
+  {
+    Phase phase(metrics,"ways");
+    db::LocationCursor locations(txn);
+    ObjectBuilder builder(txn,false);
+    FeatureWriter writer(format);
+    string lines;
+    osmium::memory::Buffer buffer{1 << 20,osmium::memory::Buffer::auto_grow::yes};
+    size_t batched = 0;
+    auto flush = [&]() {
+      setLocations(locations,buffer);
+      for (auto const &way : buffer.select<osmium::Way>()) {
+        // untagged ways are only parts of multipolygons, not features.
+        if (way.tags().empty()) continue;
+        if (writer.way(lines,way)) features++;
+      }
+      out << lines;
+      lines.clear();
+      buffer.clear();
+      batched = 0;
+    };
+    for (auto way_id : way_ids) {
+      if (builder.way(buffer,way_id)) {
+        buffer.commit();
+        if (++batched == WAY_BATCH) flush();
+      }
+    }
+    flush();
+  }
+  {
+    Phase phase(metrics,"multipolygons");
+    // chunks of RELATION_CHUNK relations are split into contiguous slices and written before the next chunk,
+    // so the output is in id order no matter how many threads, and only one chunk is held in memory.
+    vector<unique_ptr<RelationWorker>> workers;
+    for (int i = 0; i < threads; i++) workers.emplace_back(new RelationWorker(env,format));
+    vector<uint64_t> ids;
+    auto assemble = [&]() {
+      size_t per_thread = (ids.size() + threads - 1) / threads;
+      size_t started = 0;
+      for (size_t i = 0; i < ids.size(); i += per_thread) {
+        workers[started++]->start(vector<uint64_t>(ids.begin() + i,ids.begin() + std::min(i + per_thread,ids.size())));
+      }
+      for (size_t i = 0; i < started; i++) workers[i]->finish(out,features);
+      ids.clear();
+    };
+    for (auto relation_id : relation_ids) {
+      ids.push_back(relation_id);
+      if (ids.size() == RELATION_CHUNK) assemble();
+    }
+    assemble();
+  }
+  out.close();
+
+  metrics.add("nodes",node_ids.cardinality());
+  metrics.add("ways",way_ids.cardinality());
+  metrics.add("relations",relation_ids.cardinality());
+  metrics.add("features",features);
+  cout << "Features: " << features << " from " << node_ids.cardinality() << " nodes, " << way_ids.cardinality() << " ways, " << relation_ids.cardinality() << " relations" << endl;
+  if (result.count("metrics")) metrics.write(result["metrics"].as<string>());
+}
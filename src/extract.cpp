@@ -1,17 +1,23 @@
 #include <string>
 #include <fstream>
+#include <cstring>
+#include <set>
+#include <tuple>
+#include <algorithm>
 #include "s2/s2latlng.h"
 #include "s2/s2region_coverer.h"
 #include "s2/s2latlng_rect.h"
 #include "osmium/io/any_output.hpp"
 #include "osmium/util/progress_bar.hpp"
 #include "osmium/memory/callback_buffer.hpp"
-#include "osmium/builder/attr.hpp"
-#include "osmium/builder/osm_object_builder.hpp"
 #include "cxxopts.hpp"
 #include "nlohmann/json.hpp"
 #include "osmx/storage.h"
 #include "osmx/region.h"
+#include "osmx/metrics.h"
+#include "osmx/builder.h"
+#include "osmx/tag_filter.h"
+#include "osmx/manifest.h"
 
 using namespace std;
 using namespace osmx;
@@ -33,7 +39,7 @@ struct ExportProgress {
 class ProgressSection {
 
 public:
-  ProgressSection(ExportProgress &expprog, uint64_t &total, uint64_t &prog, uint64_t total_to_set, bool jsonOutput) : expprog(expprog), total(total), prog(prog), progressbar(total_to_set, osmium::isatty(2) && !jsonOutput), jsonOutput(jsonOutput) {
+  ProgressSection(ExportProgress &expprog, uint64_t &total, uint64_t &prog, uint64_t total_to_set, bool jsonOutput) : expprog(expprog), total(total), prog(prog), progressbar(total_to_set, osmium::isatty(2) && !jsonOutput && !quiet()), jsonOutput(jsonOutput) {
     total = total_to_set;
   }
 
@@ -59,9 +65,372 @@ private:
     uint64_t last_prog = 0;
 };
 
-static bool endsWith(const std::string& str, const std::string& suffix)
-{
-    return str.size() >= suffix.size() && 0 == str.compare(str.size()-suffix.size(), suffix.size(), suffix);
+static S2CellUnion getCovering(Region &region, int expand) {
+  S2RegionCoverer::Options options;
+  options.set_max_cells(1024);
+  options.set_max_level(CELL_INDEX_LEVEL);
+  S2RegionCoverer coverer(options);
+  S2CellUnion covering = region.GetCovering(coverer);
+  if (expand >= 0 && expand <= 16) {
+    covering.Expand(expand);
+  }
+  return covering;
+}
+
+// planet.osm.pbf averages about 8 bytes per node, way or relation.
+static const double PBF_BYTES_PER_ELEMENT = 8;
+
+// approximate counts of an extract, without reading node ids.
+// nodes are counted from cell_count, or per key of cell_node for small cells and older files.
+// ways and relations are scaled from nodes, by the ratio in sample cells if sample > 0, otherwise in the whole file.
+static void estimateExtract(MDB_txn *txn, const S2CellUnion &covering, int sample, bool jsonOutput) {
+  db::CellCounts counts(txn);
+  db::IndexCursor cells(txn,"cell_node");
+
+  uint64_t nodes = 0;
+  for (auto cell_id : covering.cell_ids()) {
+    if (counts.present() && cell_id.level() <= CELL_COUNT_LEVEL) nodes += counts.count(cell_id);
+    else nodes += cells.countCell(cell_id);
+  }
+
+  double ways_per_node = 0;
+  double relations_per_node = 0;
+  uint64_t total_nodes = db::tableEntries(txn,"locations");
+  if (total_nodes > 0) {
+    ways_per_node = (double)db::tableEntries(txn,"ways") / total_nodes;
+    relations_per_node = (double)db::tableEntries(txn,"relations") / total_nodes;
+  }
+
+  if (sample > 0 && covering.size() > 0) {
+    Roaring64Map sample_nodes;
+    Roaring64Map sample_ways;
+    Roaring64Map sample_relations;
+    int sample_cells = std::min(sample,covering.size());
+    for (int i = 0; i < sample_cells; i++) {
+      cells.traverseCell(covering.cell_id(i * covering.size() / sample_cells),sample_nodes);
+    }
+
+    db::IndexCursor node_way(txn,"node_way");
+    db::IndexCursor node_relation(txn,"node_relation");
+    db::IndexCursor way_relation(txn,"way_relation");
+    for (auto const &node_id : sample_nodes) node_way.traverseReverse(node_id,sample_ways);
+    for (auto const &node_id : sample_nodes) node_relation.traverseReverse(node_id,sample_relations);
+    for (auto const &way_id : sample_ways) way_relation.traverseReverse(way_id,sample_relations);
+
+    if (sample_nodes.cardinality() > 0) {
+      ways_per_node = (double)sample_ways.cardinality() / sample_nodes.cardinality();
+      relations_per_node = (double)sample_relations.cardinality() / sample_nodes.cardinality();
+    }
+  }
+
+  uint64_t ways = nodes * ways_per_node;
+  uint64_t relations = nodes * relations_per_node;
+  uint64_t bytes = (nodes + ways + relations) * PBF_BYTES_PER_ELEMENT;
+  if (jsonOutput) {
+    cout << "{\"CellsTotal\":" << covering.size() << ",\"NodesEstimate\":" << nodes << ",\"WaysEstimate\":" << ways << ",\"RelationsEstimate\":" << relations << ",\"BytesEstimate\":" << bytes << "}" << endl;
+  } else {
+    cout << "Nodes: ~" << nodes << endl;
+    cout << "Ways: ~" << ways << endl;
+    cout << "Relations: ~" << relations << endl;
+    cout << "Size: ~" << bytes / 1000000.0 << " MB" << endl;
+  }
+}
+
+// adds the relations that contain any of relation_ids, recursively.
+static void addParentRelations(MDB_txn *txn, Roaring64Map &relation_ids) {
+  db::IndexCursor relation_relation(txn,"relation_relation");
+  Roaring64Map discovered_relations;
+  Roaring64Map discovered_relations_2;
+
+  for (auto const &relation_id : relation_ids) {
+    relation_relation.traverseReverse(relation_id,discovered_relations);
+  }
+
+  relation_ids |= discovered_relations;
+
+  while(true) {
+    for (auto const &relation_id : discovered_relations) {
+      relation_relation.traverseReverse(relation_id,discovered_relations_2);
+    }
+    int num_discovered = 0;
+    for (auto discovered_relation_id : discovered_relations_2) {
+      if (relation_ids.addChecked(discovered_relation_id)) num_discovered++;
+    }
+    if (num_discovered == 0) break;
+    discovered_relations = discovered_relations_2;
+    discovered_relations_2.clear();
+  }
+}
+
+// make it Multipolygon-complete: go through all Relations, finding any that have tag type=multipolygon, and add to Ways
+static void addMultipolygonWays(const db::StringTable &strings, db::Elements &ways, db::Elements &relations, const Roaring64Map &relation_ids, Roaring64Map &way_ids) {
+  for (auto relation_id : relation_ids) {
+    auto maybe_reader = relations.tryGet(relation_id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      Relation::Reader relation = reader->getRoot<Relation>();
+      bool multipolygon = false;
+      db::forEachTag(strings,relation,[&](const char *key, const char *value) {
+        if (!strcmp(key,"type") && !strcmp(value,"multipolygon")) multipolygon = true;
+      });
+      if (multipolygon) {
+        for (auto const &member : relation.getMembers()) {
+          if (member.getType() == RelationMember::Type::WAY) {
+            auto ref = member.getRef();
+            // check if the way exists, because this may be an extract
+            if (!way_ids.contains(ref) && ways.exists(ref)) way_ids.add(ref);
+          }
+        }
+      }
+    }
+  }
+}
+
+// make it Way-complete: go through all Ways and add in any missing Nodes.
+static void addWayNodes(db::Elements &ways, const Roaring64Map &way_ids, Roaring64Map &node_ids) {
+  for (auto way_id : way_ids) {
+    auto maybe_reader = ways.tryGet(way_id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      Way::Reader way = reader->getRoot<Way>();
+      db::forEachNode(way,[&](uint64_t node_id) {
+        node_ids.add(node_id);
+      });
+    }
+  }
+}
+
+// keeps the objects matching filter, then adds what they need to be complete:
+// the direct members of kept relations and the nodes of kept ways.
+// tags are read from the stored messages, so discarded objects are never built or encoded,
+// or if the file has a tag index for the keys, the matching ids are intersected with the region.
+static void filterExtract(MDB_txn *txn, const db::StringTable &strings, const TagFilter &filter, Roaring64Map &node_ids, Roaring64Map &way_ids, Roaring64Map &relation_ids) {
+  db::LocationCursor locations(txn);
+  db::ElementCursor nodes(txn,"nodes");
+  db::ElementCursor ways(txn,"ways");
+  db::ElementCursor relations(txn,"relations");
+  Roaring64Map kept_nodes;
+  Roaring64Map kept_ways;
+  Roaring64Map kept_relations;
+
+  // with a tag index, only the relations that match are read, to add their members.
+  db::TagIndex tag_index(txn);
+  Roaring64Map candidates = relation_ids;
+  bool indexed_relations = false;
+  if (filter.filters(osmium::item_type::relation)) {
+    Roaring64Map indexed;
+    if (filter.lookup(tag_index,osmium::item_type::relation,relation_ids,indexed)) {
+      candidates = std::move(indexed);
+      indexed_relations = true;
+    }
+    for (auto relation_id : candidates) {
+      auto maybe_reader = relations.tryGet(relation_id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        Relation::Reader relation = reader->getRoot<Relation>();
+        if (!indexed_relations && !filter.matches(strings,osmium::item_type::relation,relation)) continue;
+        kept_relations.add(relation_id);
+        for (auto const &member : relation.getMembers()) {
+          auto ref = member.getRef();
+          if (member.getType() == RelationMember::Type::NODE) {
+            if (locations.exists(ref)) kept_nodes.add(ref);
+          } else if (member.getType() == RelationMember::Type::WAY) {
+            if (ways.exists(ref)) kept_ways.add(ref);
+          }
+        }
+      }
+    }
+  }
+
+  Roaring64Map indexed;
+  if (filter.filters(osmium::item_type::way) && filter.lookup(tag_index,osmium::item_type::way,way_ids,indexed)) {
+    kept_ways |= indexed;
+  } else if (filter.filters(osmium::item_type::way)) {
+    for (auto way_id : way_ids) {
+      auto maybe_reader = ways.tryGet(way_id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        if (filter.matches(strings,osmium::item_type::way,reader->getRoot<Way>())) kept_ways.add(way_id);
+      }
+    }
+  }
+
+  // untagged nodes are only in the locations table, so they never match.
+  indexed.clear();
+  if (filter.filters(osmium::item_type::node) && filter.lookup(tag_index,osmium::item_type::node,node_ids,indexed)) {
+    kept_nodes |= indexed;
+  } else if (filter.filters(osmium::item_type::node)) {
+    for (auto node_id : node_ids) {
+      auto maybe_reader = nodes.tryGet(node_id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        if (filter.matches(strings,osmium::item_type::node,reader->getRoot<Node>())) kept_nodes.add(node_id);
+      }
+    }
+  }
+
+  addWayNodes(ways,kept_ways,kept_nodes);
+  node_ids = std::move(kept_nodes);
+  way_ids = std::move(kept_ways);
+  relation_ids = std::move(kept_relations);
+}
+
+static void writeExtract(MDB_txn *txn, const string &output, const string &timestamp, const S2LatLngRect &bounds,
+  const Roaring64Map &node_ids, const Roaring64Map &way_ids, const Roaring64Map &relation_ids,
+  bool includeUserData, ExportProgress &prog, bool jsonOutput, Metrics &metrics) {
+  osmium::io::Header header;
+  header.set("generator", "osmx");
+  header.set("timestamp", timestamp);
+  header.set("osmosis_replication_timestamp", timestamp);
+
+  // the box header is used by some applications,
+  // for example: zooming to an overview in QGIS.
+  // however, osmium only supports writing one PBF box header and it must be in the -180 to 180 lng, -90 to 90 lat range.
+  // valid input regions can cross the antimeridian, but the output header box is omitted as it can't represent the input.
+  if (bounds.lng_lo().degrees() < bounds.lng_hi().degrees()) {
+    header.add_box(osmium::Box(bounds.lng_lo().degrees(),bounds.lat_lo().degrees(),bounds.lng_hi().degrees(),bounds.lat_hi().degrees()));
+  }
+  osmium::io::Writer writer{output, header, osmium::io::overwrite::allow};
+  osmium::memory::CallbackBuffer cb;
+  cb.set_callback([&](osmium::memory::Buffer&& buffer) {
+    writer(std::move(buffer));
+  });
+
+  {
+    Phase phase(metrics,"write");
+    ProgressSection section(prog,prog.elems_total,prog.elems_prog,node_ids.cardinality() + way_ids.cardinality() + relation_ids.cardinality(),jsonOutput);
+    ObjectBuilder builder(txn,includeUserData);
+
+    for (auto node_id : node_ids) {
+      section.tick();
+      if (builder.node(cb.buffer(),node_id)) {
+        cb.buffer().commit();
+        cb.possibly_flush();
+      }
+    }
+
+    for (auto way_id : way_ids) {
+      section.tick();
+      if (builder.way(cb.buffer(),way_id)) {
+        cb.buffer().commit();
+        cb.possibly_flush();
+      }
+    }
+
+    for (auto relation_id : relation_ids) {
+      section.tick();
+      if (builder.relation(cb.buffer(),relation_id)) {
+        cb.buffer().commit();
+        cb.possibly_flush();
+      }
+    }
+
+    cb.flush();
+    writer.close();
+  }
+}
+
+// one region of a batch extract.
+struct BatchRegion {
+  string output;
+  std::unique_ptr<Region> region;
+  Roaring64Map node_ids;
+  Roaring64Map way_ids;
+  Roaring64Map relation_ids;
+};
+
+// extracts every region listed in batchFile.
+// cell_node, node_way and node_relation are read once for all regions;
+// relations of ways, materialization and writing are per region.
+static void batchExtract(MDB_txn *txn, const string &batchFile, int expand, const TagFilter &filter, bool includeUserData, bool jsonOutput, Metrics &metrics) {
+  vector<BatchRegion> regions;
+  vector<S2CellUnion> coverings;
+  {
+    Phase phase(metrics,"covering");
+    std::ifstream file(batchFile);
+    string line;
+    while (std::getline(file,line)) {
+      std::istringstream fields(line);
+      string region_file;
+      string output;
+      if (!(fields >> region_file >> output) || region_file[0] == '#') continue;
+      auto region = Region::FromFile(region_file);
+      if (!region) {
+        cout << "Unknown region file type: " << region_file << endl;
+        exit(1);
+      }
+      coverings.push_back(getCovering(*region,expand));
+      metrics.add("covering_cells",coverings.back().size());
+      regions.push_back(BatchRegion{output,std::move(region)});
+    }
+  }
+  auto ranges = batchRanges(coverings);
+  if (!jsonOutput) progress() << "Regions: " << regions.size() << ", shared ranges: " << ranges.size() << endl;
+
+  db::Metadata metadata(txn);
+  db::StringTable strings(txn);
+  auto timestamp = metadata.get("osmosis_replication_timestamp");
+
+  {
+    Phase phase(metrics,"cell_scan");
+    osmium::ProgressBar progress{ranges.size(), osmium::isatty(2) && !jsonOutput && !quiet()};
+    db::IndexCursor cell_node(txn,"cell_node");
+    db::IndexCursor node_way(txn,"node_way");
+    db::IndexCursor node_relation(txn,"node_relation");
+    size_t done = 0;
+    for (auto const &range : ranges) {
+      Roaring64Map range_nodes;
+      Roaring64Map range_ways;
+      Roaring64Map range_relations;
+      cell_node.traverseRange(range.start,range.end,range_nodes);
+      for (auto const &node_id : range_nodes) {
+        node_way.traverseReverse(node_id,range_ways);
+        node_relation.traverseReverse(node_id,range_relations);
+      }
+      for (auto i : range.regions) {
+        regions[i].node_ids |= range_nodes;
+        regions[i].way_ids |= range_ways;
+        regions[i].relation_ids |= range_relations;
+      }
+      metrics.add("cell_scan_nodes",range_nodes.cardinality());
+      progress.update(++done);
+    }
+    progress.done();
+  }
+
+  db::ElementCursor ways(txn,"ways");
+  db::ElementCursor relations(txn,"relations");
+  for (auto &r : regions) {
+    {
+      Phase phase(metrics,"relation_closure");
+      db::IndexCursor way_relation(txn,"way_relation");
+      for (auto const &way_id : r.way_ids) {
+        way_relation.traverseReverse(way_id,r.relation_ids);
+      }
+      addParentRelations(txn,r.relation_ids);
+    }
+    {
+      Phase phase(metrics,"materialization");
+      if (!filter.empty()) {
+        filterExtract(txn,strings,filter,r.node_ids,r.way_ids,r.relation_ids);
+      } else {
+        addMultipolygonWays(strings,ways,relations,r.relation_ids,r.way_ids);
+        addWayNodes(ways,r.way_ids,r.node_ids);
+      }
+    }
+
+    ExportProgress prog;
+    prog.timestamp = timestamp;
+    writeExtract(txn,r.output,timestamp,r.region->GetBounds(),r.node_ids,r.way_ids,r.relation_ids,includeUserData,prog,jsonOutput,metrics);
+    metrics.add("nodes",r.node_ids.cardinality());
+    metrics.add("ways",r.way_ids.cardinality());
+    metrics.add("relations",r.relation_ids.cardinality());
+    if (jsonOutput) {
+      cout << "{\"Output\":\"" << r.output << "\",\"Nodes\":" << r.node_ids.cardinality() << ",\"Ways\":" << r.way_ids.cardinality() << ",\"Relations\":" << r.relation_ids.cardinality() << "}" << endl;
+    } else {
+      progress() << r.output << ": " << r.node_ids.cardinality() << " nodes, " << r.way_ids.cardinality() << " ways, " << r.relation_ids.cardinality() << " relations" << endl;
+    }
+
+    // the bitmaps of finished regions are not needed anymore.
+    r.node_ids = Roaring64Map();
+    r.way_ids = Roaring64Map();
+    r.relation_ids = Roaring64Map();
+  }
 }
 
 // must be --bbox, --disc, --poly or --json
@@ -70,6 +439,7 @@ void cmdExtract(int argc, char * argv[]) {
   cxxopts::Options cmd_options("Extract", "Create an .osm.pbf from an .osmx file.");
   cmd_options.add_options()
     ("v,verbose", "Verbose output")
+    ("quiet", "Don't print progress")
     ("noUserData", "Don't include changeset,uid,user fields (GDPR compliance)")
     ("jsonOutput", "JSON progress output")
     ("cmd", "Command to run", cxxopts::value<string>())
@@ -81,16 +451,25 @@ void cmdExtract(int argc, char * argv[]) {
     ("poly","osmosis .poly of region", cxxopts::value<string>())
     ("region","file for region with extension .bbox, .disc, .json or .poly", cxxopts::value<string>())
     ("expand","buffer at this cell level",cxxopts::value<int>())
+    ("metrics","write metrics to this file",cxxopts::value<string>())
+    ("estimate","print approximate counts instead of extracting")
+    ("sample","with --estimate, scale ways and relations by N sampled cells",cxxopts::value<int>())
+    ("batch","file with a region file and an output file on each line",cxxopts::value<string>())
+    ("tags","only objects matching [TYPES/]KEY[=VALUE], comma separated",cxxopts::value<vector<string>>())
   ;
   cmd_options.parse_positional({"cmd","osmx","output"});
   auto result = cmd_options.parse(argc, argv);
 
-  if (result.count("osmx") == 0 || result.count("output") == 0) {
-    cout << "Usage: osmx extract OSMX_FILE OUTPUT_FILE [OPTIONS]" << endl << endl;
+  bool estimate = result.count("estimate") > 0;
+  bool batch = result.count("batch") > 0;
+  if (result.count("osmx") == 0 || (result.count("output") == 0 && !estimate && !batch)) {
+    cout << "Usage: osmx extract OSMX_FILE OUTPUT_FILE [OPTIONS]" << endl;
+    cout << "OSMX_FILE may also be a shard manifest ending in .json, to extract from the smallest shard containing the region." << endl << endl;
     cout << "EXAMPLE:" << endl;
     cout << " osmx extract planet.osmx extract.osm.pbf --region region.json" << endl << endl;
     cout << "OPTIONS:" << endl;
     cout << " --v,--verbose: verbose output." << endl;
+    cout << " --quiet: don't print progress, only errors." << endl;
     cout << " --jsonOutput: log progress as JSON messages." << endl;
     cout << " --bbox MIN_LAT,MIN_LON,MAX_LAT,MAX_LON: region is lat/lon bbox" << endl;
     cout << " --disc CENTER_LAT,CENTER_LON,R_DEGREES: region is disc" << endl;
@@ -98,6 +477,11 @@ void cmdExtract(int argc, char * argv[]) {
     cout << " --poly POLY: region is an Osmosis polygon" << endl;
     cout << " --region FILE: text file with .bbox, .disc, .json or .poly extension" << endl;
     cout << " --expand CELL_LEVEL: buffer region with cells at this level, <= 16" << endl;
+    cout << " --metrics FILE: write phase timings and counters as JSON, or Prometheus text if FILE ends in .prom; - for stdout" << endl;
+    cout << " --estimate: print approximate node, way and relation counts and PBF size without extracting. OUTPUT_FILE is not needed" << endl;
+    cout << " --sample N: with --estimate, estimate ways and relations from N cells of the region instead of the whole file" << endl;
+    cout << " --batch FILE: extract many regions with one scan of the index. Each line of FILE is a region file and an output file. OUTPUT_FILE is not needed" << endl;
+    cout << " --tags EXPR[,EXPR...]: only write objects with a matching tag, and the nodes and members they need. EXPR is [TYPES/]KEY[=VALUE], TYPES any of n, w and r, e.g. w/highway,n/amenity=hospital" << endl;
     exit(1);
   }
 
@@ -106,325 +490,174 @@ void cmdExtract(int argc, char * argv[]) {
   string err;
 
   bool jsonOutput = result.count("jsonOutput") > 0;
+  if (result.count("quiet")) quiet() = true;
   if (jsonOutput) prog.print();
 
   bool includeUserData = result.count("noUserData") == 0;
+  bool collectMetrics = result.count("metrics") > 0;
+  Metrics metrics("extract");
 
   std::unique_ptr<Region> region;
   if (result.count("bbox")) region = std::make_unique<Region>(result["bbox"].as<string>(),"bbox");
   else if (result.count("disc")) region = std::make_unique<Region>(result["disc"].as<string>(),"disc");
   else if (result.count("geojson")) region = std::make_unique<Region>(result["geojson"].as<string>(),"geojson");
   else if (result.count("poly")) region = std::make_unique<Region>(result["poly"].as<string>(),"poly");
-  else if (result.count("region")) {
-    auto fname = result["region"].as<string>();
-    std::ifstream t(fname);
-    std::stringstream buffer;
-    buffer << t.rdbuf();
-    if (endsWith(fname,"bbox")) region = std::make_unique<Region>(buffer.str(),"bbox");
-    if (endsWith(fname,"disc")) region = std::make_unique<Region>(buffer.str(),"disc");
-    if (endsWith(fname,"json")) region = std::make_unique<Region>(buffer.str(),"geojson");
-    if (endsWith(fname,"poly")) region = std::make_unique<Region>(buffer.str(),"poly");
+  else if (result.count("region")) region = Region::FromFile(result["region"].as<string>());
+  else if (batch) {
+    // each line of the batch file names its own region.
   } else {
     cout << "No region specified." << endl;
     exit(0);
   }
 
-  S2RegionCoverer::Options options;
-  options.set_max_cells(1024);
-  options.set_max_level(CELL_INDEX_LEVEL);
-  S2RegionCoverer coverer(options);
-  S2CellUnion covering = region->GetCovering(coverer);
-
-  if (result.count("expand")) {
-    int expand = result["expand"].as<int>();
-    if (expand >= 0 && expand <= 16) {
-      covering.Expand(expand);
+  TagFilter filter;
+  if (result.count("tags")) {
+    for (auto const &expression : result["tags"].as<vector<string>>()) {
+      if (!filter.add(expression)) {
+        cout << "Invalid tag expression: " << expression << endl;
+        exit(1);
+      }
     }
   }
 
+  int expand = result.count("expand") ? result["expand"].as<int>() : -1;
+  if (batch) {
+    db::Env env(result["osmx"].as<string>());
+    db::Txn txn(env);
+    batchExtract(txn,result["batch"].as<string>(),expand,filter,includeUserData,jsonOutput,metrics);
+    if (collectMetrics) metrics.lmdb(env,txn);
+    if (collectMetrics) metrics.write(result["metrics"].as<string>());
+    return;
+  }
+
+  S2CellUnion covering;
+  {
+    Phase phase(metrics,"covering");
+    covering = getCovering(*region,expand);
+  }
+  metrics.add("covering_cells",covering.size());
+
   if (!jsonOutput) {
-    cout << "Query cells: " << covering.cell_ids().size() << endl;
+    progress() << "Query cells: " << covering.cell_ids().size() << endl;
   }
 
   Roaring64Map node_ids;
   Roaring64Map way_ids;
   Roaring64Map relation_ids;
 
-  MDB_env* env = db::createEnv(result["osmx"].as<string>(),false);
-  MDB_txn* txn;
-  CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+  // a manifest of regional shards: extract from the smallest shard that contains the region.
+  string osmx = result["osmx"].as<string>();
+  if (osmx.size() > 5 && osmx.compare(osmx.size() - 5,5,".json") == 0) {
+    Manifest manifest(osmx);
+    auto shard = manifest.route(covering);
+    if (!shard) {
+      cout << "No shard in " << osmx << " contains the region." << endl;
+      exit(1);
+    }
+    osmx = shard->osmx;
+    if (!jsonOutput) progress() << "Shard: " << osmx << endl;
+  }
+
+  db::Env env(osmx);
+  db::Txn txn(env);
 
   db::Metadata metadata(txn);
+  db::StringTable strings(txn);
   auto timestamp = metadata.get("osmosis_replication_timestamp");
   prog.timestamp = timestamp;
   if (!jsonOutput) {
-    cout << "Snapshot timestamp is " << prog.timestamp  << endl;
+    progress() << "Snapshot timestamp is " << prog.timestamp  << endl;
+  }
+
+  if (estimate) {
+    estimateExtract(txn,covering,result.count("sample") ? result["sample"].as<int>() : 0,jsonOutput);
+    return;
   }
 
   {
+    Phase phase(metrics,"cell_scan");
     ProgressSection section(prog,prog.cells_total,prog.cells_prog,covering.size(),jsonOutput);
-    MDB_dbi dbi;
-    MDB_cursor *cursor;
-    CHECK(mdb_dbi_open(txn, "cell_node", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
-    CHECK(mdb_cursor_open(txn,dbi,&cursor));
+    db::IndexCursor cell_node(txn,"cell_node");
     for (auto cell_id : covering.cell_ids()) {
-      db::traverseCell(cursor,cell_id,node_ids);
+      uint64_t before = collectMetrics ? node_ids.cardinality() : 0;
+      cell_node.traverseCell(cell_id,node_ids);
+      if (collectMetrics) metrics.observe("cell_nodes",node_ids.cardinality() - before);
       section.tick();
     }
-    mdb_cursor_close(cursor);
   }
+  metrics.add("cell_scan_nodes",node_ids.cardinality());
 
-  {
+  // with a tag filter for nodes only, ways and relations are not looked up at all.
+  bool needRelations = filter.empty() || filter.filters(osmium::item_type::relation);
+  bool needWays = needRelations || filter.filters(osmium::item_type::way);
+
+  if (needWays) {
+    Phase phase(metrics,"reverse_lookup");
     ProgressSection section(prog,prog.nodes_total,prog.nodes_prog,node_ids.cardinality(),jsonOutput);
-    MDB_dbi dbi;
-    MDB_cursor *cursor;
-    CHECK(mdb_dbi_open(txn, "node_way", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
-    CHECK(mdb_cursor_open(txn,dbi,&cursor));
+    db::IndexCursor node_way(txn,"node_way");
     for (auto const &node_id : node_ids) {
-      db::traverseReverse(cursor,node_id,way_ids);
+      node_way.traverseReverse(node_id,way_ids);
       section.tick();
     }
   }
 
 
+  metrics.add("reverse_lookup_ways",way_ids.cardinality());
+
   // find all Relations that these nodes or Ways are a member of.
-  {
-    MDB_dbi dbi;
-    MDB_cursor *cursor;
-    CHECK(mdb_dbi_open(txn, "node_relation", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
-    CHECK(mdb_cursor_open(txn,dbi,&cursor));
+  if (needRelations) {
+    Phase phase(metrics,"relation_closure");
+    db::IndexCursor node_relation(txn,"node_relation");
     for (auto const &node_id : node_ids) {
-      db::traverseReverse(cursor,node_id,relation_ids);
+      node_relation.traverseReverse(node_id,relation_ids);
     }
   }
 
-  {
-    MDB_dbi dbi;
-    MDB_cursor *cursor;
-    CHECK(mdb_dbi_open(txn, "way_relation", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
-    CHECK(mdb_cursor_open(txn,dbi,&cursor));
+  if (needRelations) {
+    Phase phase(metrics,"relation_closure");
+    db::IndexCursor way_relation(txn,"way_relation");
     for (auto const &way_id : way_ids) {
-      db::traverseReverse(cursor,way_id,relation_ids);
-    }
-  }
-
-  {
-    MDB_dbi dbi;
-    MDB_cursor *cursor;
-    CHECK(mdb_dbi_open(txn, "relation_relation", MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
-    CHECK(mdb_cursor_open(txn,dbi,&cursor));
-    Roaring64Map discovered_relations;
-    Roaring64Map discovered_relations_2;
-
-    for (auto const &relation_id : relation_ids) {
-      db::traverseReverse(cursor,relation_id,discovered_relations);
-    }
-
-    relation_ids |= discovered_relations;
-
-    while(true) {
-      for (auto const &relation_id : discovered_relations) {
-        db::traverseReverse(cursor,relation_id,discovered_relations_2);
-      }
-      int num_discovered = 0;
-      for (auto discovered_relation_id : discovered_relations_2) {
-        if (relation_ids.addChecked(discovered_relation_id)) num_discovered++;
-      }
-      if (num_discovered == 0) break;
-      discovered_relations = discovered_relations_2;
-      discovered_relations_2.clear();
-    }
-  }
-
-  if (!jsonOutput) cout << "Relations: " << relation_ids.cardinality() << endl;
-  db::Elements ways(txn,"ways");
-  db::Elements relations(txn,"relations");
-
-  // make it Multipolygon-complete: go through all Relations, finding any that have tag type=multipolygon, and add to Ways
-
-  for (auto relation_id : relation_ids) {
-    auto reader = relations.getReader(relation_id);
-    Relation::Reader relation = reader.getRoot<Relation>();
-    auto tags = relation.getTags();
-    for (int i = 0; i < tags.size() / 2; i++) {
-      if (tags[i*2] == "type" && tags[i*2+1] == "multipolygon") {
-        for (auto const &member : relation.getMembers()) {
-          if (member.getType() == RelationMember::Type::WAY) {
-            auto ref = member.getRef();
-            // check if the way exists, because this may be an extract
-            if (ways.exists(ref)) way_ids.add(member.getRef());
-          }
-        }
-      }
+      way_relation.traverseReverse(way_id,relation_ids);
     }
   }
 
-  if (!jsonOutput) cout << "Ways: " << way_ids.cardinality() << endl;
-
-  // make it Way-complete: go through all Ways and add in any missing Nodes.
-
-  {
-    for (auto way_id : way_ids) {
-      auto reader = ways.getReader(way_id);
-      Way::Reader way = reader.getRoot<Way>();
-      for (auto node_id : way.getNodes()) {
-        node_ids.add(node_id);
-      }
-    }
-  }
-
-  if (!jsonOutput) cout << "Nodes: " << node_ids.cardinality() << endl;
-
-  // start Write
-
-  osmium::io::Header header;
-  header.set("generator", "osmx");
-  header.set("timestamp", timestamp);
-  header.set("osmosis_replication_timestamp", timestamp);
-
-  auto bounds = region->GetBounds();
-
-
-  // the box header is used by some applications,
-  // for example: zooming to an overview in QGIS.
-  // however, osmium only supports writing one PBF box header and it must be in the -180 to 180 lng, -90 to 90 lat range.
-  // valid input regions can cross the antimeridian, but the output header box is omitted as it can't represent the input.
-  if (bounds.lng_lo().degrees() < bounds.lng_hi().degrees()) {
-    header.add_box(osmium::Box(bounds.lng_lo().degrees(),bounds.lat_lo().degrees(),bounds.lng_hi().degrees(),bounds.lat_hi().degrees()));
+  if (needRelations) {
+    Phase phase(metrics,"relation_closure");
+    addParentRelations(txn,relation_ids);
   }
-  osmium::io::Writer writer{result["output"].as<string>(), header, osmium::io::overwrite::allow};
-  osmium::memory::CallbackBuffer cb;
-  cb.set_callback([&](osmium::memory::Buffer&& buffer) {
-    writer(std::move(buffer));
-  });
 
-  {
-    ProgressSection section(prog,prog.elems_total,prog.elems_prog,node_ids.cardinality() + way_ids.cardinality() + relation_ids.cardinality(),jsonOutput);
+  if (!filter.empty()) {
+    Phase phase(metrics,"materialization");
+    filterExtract(txn,strings,filter,node_ids,way_ids,relation_ids);
+    if (!jsonOutput) progress() << "Relations: " << relation_ids.cardinality() << endl;
+    if (!jsonOutput) progress() << "Ways: " << way_ids.cardinality() << endl;
+  } else {
+    if (!jsonOutput) progress() << "Relations: " << relation_ids.cardinality() << endl;
+    db::ElementCursor ways(txn,"ways");
+    db::ElementCursor relations(txn,"relations");
 
     {
-      db::Locations location_index(txn);
-      db::Elements nodes_table(txn,"nodes");
-      for (auto node_id : node_ids) {
-        section.tick();
-        auto loc = location_index.get(node_id);
-        if (loc.is_undefined()) continue;
-
-        {
-          using namespace osmium::builder::attr; 
-          osmium::builder::NodeBuilder node_builder{cb.buffer()};
-          node_builder.set_id(node_id);
-          node_builder.set_location(loc.coords);
-          node_builder.set_version(loc.version);
-
-          if (!nodes_table.exists(node_id)) continue;
-          auto reader = nodes_table.getReader(node_id);
-          Node::Reader node = reader.getRoot<Node>();
-          auto metadata = node.getMetadata();
-          node_builder.set_timestamp(metadata.getTimestamp());
-          if (includeUserData) {
-            node_builder.set_changeset(metadata.getChangeset());
-            node_builder.set_user(metadata.getUser());
-            node_builder.set_uid(metadata.getUid());
-          }
-
-          auto tags = node.getTags();
-          osmium::builder::TagListBuilder tag_builder{node_builder};
-          for (int i = 0; i < tags.size() / 2; i++) {
-            tag_builder.add_tag(tags[i*2],tags[i*2+1]);
-          }
-        }
-        cb.buffer().commit();
-        cb.possibly_flush();
-      }
+      Phase phase(metrics,"materialization");
+      addMultipolygonWays(strings,ways,relations,relation_ids,way_ids);
     }
-    
-    // Writing ways pass
-    {
-      for (auto way_id : way_ids) {
-        section.tick();
-        auto reader = ways.getReader(way_id);
-        Way::Reader way = reader.getRoot<Way>();
-
-        {
-          using namespace osmium::builder::attr; 
-          osmium::builder::WayBuilder way_builder{cb.buffer()};
-          way_builder.set_id(way_id);
-          auto metadata = way.getMetadata();
-          way_builder.set_version(metadata.getVersion());
-          way_builder.set_timestamp(metadata.getTimestamp());
-          if (includeUserData) {
-            way_builder.set_changeset(metadata.getChangeset());
-            way_builder.set_user(metadata.getUser());
-            way_builder.set_uid(metadata.getUid());
-          }
 
-          {
-            osmium::builder::WayNodeListBuilder way_node_list_builder{way_builder};
-            for (auto node_id : way.getNodes()) {
-              way_node_list_builder.add_node_ref(node_id);
-            }
-          }
-
-          auto tags = way.getTags();
-          osmium::builder::TagListBuilder tag_builder{way_builder};
-          for (int i = 0; i < tags.size() / 2; i++) {
-            tag_builder.add_tag(tags[i*2],tags[i*2+1]);
-          }
-        }
-        cb.buffer().commit();
-        cb.possibly_flush();
-      }
-    }
+    if (!jsonOutput) progress() << "Ways: " << way_ids.cardinality() << endl;
 
     {
-      for (auto relation_id : relation_ids) {
-        section.tick();
-        auto reader = relations.getReader(relation_id);
-        Relation::Reader relation = reader.getRoot<Relation>();
-
-        {
-          using namespace osmium::builder::attr; 
-          osmium::builder::RelationBuilder relation_builder{cb.buffer()};
-          relation_builder.set_id(relation_id);
-
-          auto metadata = relation.getMetadata();
-          relation_builder.set_version(metadata.getVersion());
-          relation_builder.set_timestamp(metadata.getTimestamp());
-          if (includeUserData) {
-            relation_builder.set_changeset(metadata.getChangeset());
-            relation_builder.set_user(metadata.getUser());
-            relation_builder.set_uid(metadata.getUid());
-          }
-
-          {
-            osmium::builder::RelationMemberListBuilder relation_member_list_builder{relation_builder};
-            for (auto const &member : relation.getMembers()) {
-              if (member.getType() == RelationMember::Type::NODE) {
-                relation_member_list_builder.add_member(osmium::item_type::node,member.getRef(),member.getRole());
-              } else if (member.getType() == RelationMember::Type::WAY) {
-                relation_member_list_builder.add_member(osmium::item_type::way,member.getRef(),member.getRole());
-              } else {
-                relation_member_list_builder.add_member(osmium::item_type::relation,member.getRef(),member.getRole());
-              }
-            }
-          }
-
-          auto tags = relation.getTags();
-          osmium::builder::TagListBuilder tag_builder{relation_builder};
-          for (int i = 0; i < tags.size() / 2; i++) {
-            tag_builder.add_tag(tags[i*2],tags[i*2+1]);
-          }
-        }
-        cb.buffer().commit();
-        cb.possibly_flush();
-      }
+      Phase phase(metrics,"materialization");
+      addWayNodes(ways,way_ids,node_ids);
     }
   }
 
+  if (!jsonOutput) progress() << "Nodes: " << node_ids.cardinality() << endl;
+
+  writeExtract(txn,result["output"].as<string>(),timestamp,region->GetBounds(),node_ids,way_ids,relation_ids,includeUserData,prog,jsonOutput,metrics);
 
-  cb.flush();
-  writer.close();
-  mdb_env_close(env);
+  metrics.add("nodes",node_ids.cardinality());
+  metrics.add("ways",way_ids.cardinality());
+  metrics.add("relations",relation_ids.cardinality());
+  if (collectMetrics) metrics.lmdb(env,txn);
   auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - startTime ).count();
-  if (!jsonOutput) cout << "Finished export in " << duration/1000.0 << " seconds." << endl;
+  if (!jsonOutput) progress() << "Finished export in " << duration/1000.0 << " seconds." << endl;
+  if (collectMetrics) metrics.write(result["metrics"].as<string>());
 }
@@ -0,0 +1,51 @@
+#include <fstream>
+#include <iostream>
+#include "s2/s2region_coverer.h"
+#include "nlohmann/json.hpp"
+#include "osmx/util.h"
+#include "osmx/region.h"
+#include "osmx/manifest.h"
+
+using namespace std;
+
+namespace osmx {
+
+Manifest::Manifest(const string &path) {
+  string dir;
+  auto slash = path.rfind('/');
+  if (slash != string::npos) dir = path.substr(0,slash + 1);
+
+  std::ifstream file(path);
+  nlohmann::json manifest;
+  file >> manifest;
+
+  S2RegionCoverer::Options options;
+  options.set_max_cells(1024);
+  options.set_max_level(CELL_INDEX_LEVEL);
+  S2RegionCoverer coverer(options);
+  for (auto const &entry : manifest["shards"]) {
+    Shard shard;
+    shard.osmx = entry["osmx"].get<string>();
+    shard.region = entry["region"].get<string>();
+    if (shard.osmx[0] != '/') shard.osmx = dir + shard.osmx;
+    if (shard.region[0] != '/') shard.region = dir + shard.region;
+    auto region = Region::FromFile(shard.region);
+    if (!region) {
+      cout << "Unknown region file type: " << shard.region << endl;
+      exit(1);
+    }
+    shard.covering = region->GetCovering(coverer);
+    mShards.push_back(std::move(shard));
+  }
+}
+
+const Manifest::Shard *Manifest::route(const S2CellUnion &covering) const {
+  const Shard *best = nullptr;
+  for (auto const &shard : mShards) {
+    if (!shard.covering.Contains(covering)) continue;
+    if (!best || shard.covering.ApproxArea() < best->covering.ApproxArea()) best = &shard;
+  }
+  return best;
+}
+
+}
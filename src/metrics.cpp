@@ -0,0 +1,161 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include "osmx/metrics.h"
+#include "osmx/storage.h"
+
+using namespace std;
+
+namespace osmx {
+
+static uint64_t majorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF,&usage);
+  return usage.ru_majflt;
+}
+
+void Metrics::observe(const string &histogram, uint64_t value) {
+  auto &h = mHistograms[histogram];
+  int bucket = 0;
+  while (bucket < 64 && (1ULL << bucket) < value) bucket++;
+  h.buckets[bucket]++;
+  h.count++;
+  h.sum += value;
+}
+
+void Metrics::phase(const string &name, double seconds, uint64_t majorFaults) {
+  for (auto &p : mPhases) {
+    if (p.first == name) {
+      p.second.seconds += seconds;
+      p.second.majorFaults += majorFaults;
+      return;
+    }
+  }
+  mPhases.push_back({name,PhaseTiming{seconds,majorFaults}});
+}
+
+void Metrics::lmdb(MDB_env *env, MDB_txn *txn) {
+  mHasLmdb = true;
+  mdb_env_info(env,&mEnvInfo);
+  mdb_env_stat(env,&mEnvStat);
+  // the tables depend on the expand options, so every table in the file is counted.
+  for (auto const &table : db::tableNames(txn)) {
+    MDB_dbi dbi;
+    if (mdb_dbi_open(txn,table.c_str(),0,&dbi) != 0) continue;
+    MDB_stat stat;
+    if (mdb_stat(txn,dbi,&stat) == 0) mTables[table] = stat;
+  }
+}
+
+nlohmann::json Metrics::json() const {
+  nlohmann::json output;
+  output["command"] = mCommand;
+  output["phases"] = nlohmann::json::array();
+  for (auto const &p : mPhases) {
+    output["phases"].push_back({{"name",p.first},{"seconds",p.second.seconds},{"major_faults",p.second.majorFaults}});
+  }
+  output["counters"] = mCounters;
+  output["histograms"] = nlohmann::json::object();
+  for (auto const &h : mHistograms) {
+    nlohmann::json buckets = nlohmann::json::object();
+    for (int i = 0; i < 65; i++) {
+      if (h.second.buckets[i] > 0) buckets[i < 64 ? to_string(1ULL << i) : "+Inf"] = h.second.buckets[i];
+    }
+    output["histograms"][h.first] = {{"count",h.second.count},{"sum",h.second.sum},{"buckets",buckets}};
+  }
+  if (mHasLmdb) {
+    nlohmann::json tables = nlohmann::json::object();
+    for (auto const &t : mTables) {
+      tables[t.first] = {
+        {"entries",t.second.ms_entries},
+        {"depth",t.second.ms_depth},
+        {"branch_pages",t.second.ms_branch_pages},
+        {"leaf_pages",t.second.ms_leaf_pages},
+        {"overflow_pages",t.second.ms_overflow_pages}
+      };
+    }
+    output["lmdb"] = {
+      {"page_size",mEnvStat.ms_psize},
+      {"map_size",mEnvInfo.me_mapsize},
+      {"last_page",mEnvInfo.me_last_pgno},
+      {"last_txn",mEnvInfo.me_last_txnid},
+      {"readers",mEnvInfo.me_numreaders},
+      {"tables",tables}
+    };
+  }
+  return output;
+}
+
+string Metrics::prometheus() const {
+  stringstream ss;
+  string command = "command=\"" + mCommand + "\"";
+
+  ss << "# TYPE osmx_phase_seconds gauge" << endl;
+  for (auto const &p : mPhases) {
+    ss << "osmx_phase_seconds{" << command << ",phase=\"" << p.first << "\"} " << p.second.seconds << endl;
+  }
+  ss << "# TYPE osmx_phase_major_faults gauge" << endl;
+  for (auto const &p : mPhases) {
+    ss << "osmx_phase_major_faults{" << command << ",phase=\"" << p.first << "\"} " << p.second.majorFaults << endl;
+  }
+
+  for (auto const &c : mCounters) {
+    ss << "# TYPE osmx_" << c.first << "_total counter" << endl;
+    ss << "osmx_" << c.first << "_total{" << command << "} " << c.second << endl;
+  }
+
+  for (auto const &h : mHistograms) {
+    ss << "# TYPE osmx_" << h.first << " histogram" << endl;
+    uint64_t cumulative = 0;
+    for (int i = 0; i < 64; i++) {
+      cumulative += h.second.buckets[i];
+      ss << "osmx_" << h.first << "_bucket{" << command << ",le=\"" << (1ULL << i) << "\"} " << cumulative << endl;
+      if (cumulative == h.second.count) break;
+    }
+    ss << "osmx_" << h.first << "_bucket{" << command << ",le=\"+Inf\"} " << h.second.count << endl;
+    ss << "osmx_" << h.first << "_sum{" << command << "} " << h.second.sum << endl;
+    ss << "osmx_" << h.first << "_count{" << command << "} " << h.second.count << endl;
+  }
+
+  if (mHasLmdb) {
+    ss << "# TYPE osmx_lmdb_map_size_bytes gauge" << endl;
+    ss << "osmx_lmdb_map_size_bytes{" << command << "} " << mEnvInfo.me_mapsize << endl;
+    ss << "# TYPE osmx_lmdb_used_bytes gauge" << endl;
+    ss << "osmx_lmdb_used_bytes{" << command << "} " << (mEnvInfo.me_last_pgno + 1) * mEnvStat.ms_psize << endl;
+    ss << "# TYPE osmx_lmdb_table_entries gauge" << endl;
+    for (auto const &t : mTables) {
+      ss << "osmx_lmdb_table_entries{" << command << ",table=\"" << t.first << "\"} " << t.second.ms_entries << endl;
+    }
+    ss << "# TYPE osmx_lmdb_table_pages gauge" << endl;
+    for (auto const &t : mTables) {
+      ss << "osmx_lmdb_table_pages{" << command << ",table=\"" << t.first << "\",type=\"branch\"} " << t.second.ms_branch_pages << endl;
+      ss << "osmx_lmdb_table_pages{" << command << ",table=\"" << t.first << "\",type=\"leaf\"} " << t.second.ms_leaf_pages << endl;
+      ss << "osmx_lmdb_table_pages{" << command << ",table=\"" << t.first << "\",type=\"overflow\"} " << t.second.ms_overflow_pages << endl;
+    }
+  }
+  return ss.str();
+}
+
+void Metrics::write(const string &path) const {
+  bool prom = path.size() >= 5 && path.compare(path.size() - 5,5,".prom") == 0;
+  string text = prom ? prometheus() : json().dump() + "\n";
+  if (path == "-") {
+    cout << text;
+  } else {
+    ofstream file(path);
+    file << text;
+  }
+}
+
+Phase::Phase(Metrics &metrics, const string &name) : mMetrics(metrics), mName(name) {
+  mStartTime = std::chrono::high_resolution_clock::now();
+  mStartFaults = majorFaults();
+}
+
+Phase::~Phase() {
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - mStartTime).count();
+  mMetrics.phase(mName,duration / 1000000.0,majorFaults() - mStartFaults);
+}
+
+}
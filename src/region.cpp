@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <set>
 #include <sstream>
+#include <tuple>
+#include <fstream>
 #include <iostream>
 #include "s2/s2latlng.h"
 #include "s2/s2latlng_rect.h"
@@ -119,6 +123,21 @@ Region::Region(const std::string &text, const std::string &ext) {
     }
 }
 
+static bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() && 0 == str.compare(str.size()-suffix.size(), suffix.size(), suffix);
+}
+
+std::unique_ptr<Region> Region::FromFile(const std::string &fname) {
+    std::ifstream t(fname);
+    std::stringstream buffer;
+    buffer << t.rdbuf();
+    if (endsWith(fname,"bbox")) return std::make_unique<Region>(buffer.str(),"bbox");
+    if (endsWith(fname,"disc")) return std::make_unique<Region>(buffer.str(),"disc");
+    if (endsWith(fname,"json")) return std::make_unique<Region>(buffer.str(),"geojson");
+    if (endsWith(fname,"poly")) return std::make_unique<Region>(buffer.str(),"poly");
+    return nullptr;
+}
+
 bool Region::Contains(S2Point p) {
     for (auto const &region : mRegions) {
         if (region->Contains(p)) return true;
@@ -155,3 +174,29 @@ S2LatLngRect Region::GetBounds() {
 
     return S2LatLngRect(S2LatLng(lat_min,lng_min),S2LatLng(lat_max,lng_max));
 }
+
+std::vector<BatchRange> batchRanges(const std::vector<S2CellUnion> &coverings) {
+    // (position, -1 for the end of a cell or 1 for the start, region)
+    std::vector<std::tuple<uint64_t,int,size_t>> events;
+    for (size_t i = 0; i < coverings.size(); i++) {
+        for (auto cell_id : coverings[i].cell_ids()) {
+            events.emplace_back(cell_id.range_min().id(),1,i);
+            events.emplace_back(cell_id.range_max().id() + 1,-1,i);
+        }
+    }
+    std::sort(events.begin(),events.end());
+
+    std::vector<BatchRange> ranges;
+    std::set<size_t> active;
+    uint64_t previous = 0;
+    for (auto const &event : events) {
+        uint64_t position = std::get<0>(event);
+        if (position > previous && !active.empty()) {
+            ranges.push_back(BatchRange{previous,position,std::vector<size_t>(active.begin(),active.end())});
+        }
+        if (std::get<1>(event) > 0) active.insert(std::get<2>(event));
+        else active.erase(std::get<2>(event));
+        previous = position;
+    }
+    return ranges;
+}
@@ -0,0 +1,120 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include "cxxopts.hpp"
+#include "osmx/storage.h"
+
+using namespace std;
+using namespace osmx;
+
+static string baseName(const string &path) {
+  auto slash = path.rfind('/');
+  string name = slash == string::npos ? path : path.substr(slash + 1);
+  if (name.size() > 5 && name.compare(name.size() - 5,5,".osmx") == 0) name = name.substr(0,name.size() - 5);
+  return name;
+}
+
+// removes a file and the lock file LMDB creates next to it.
+static void removeSnapshot(const string &path) {
+  unlink(path.c_str());
+  unlink((path + "-lock").c_str());
+}
+
+void cmdSnapshot(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Snapshot", "Write a compacted copy of an .osmx file while it is being updated.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("dir", "Directory for snapshots", cxxopts::value<string>())
+    ("keep", "Number of snapshots to keep", cxxopts::value<int>()->default_value("2"))
+  ;
+  cmdoptions.parse_positional({"cmd","osmx","dir"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("osmx") == 0 || result.count("dir") == 0) {
+    cout << "Usage: osmx snapshot OSMX_FILE DIR [OPTIONS]" << endl;
+    cout << "Copies OSMX_FILE as of one transaction into DIR/NAME.SEQNUM.osmx, compacted, while updates keep running." << endl;
+    cout << "DIR/NAME.osmx is then switched atomically to the new snapshot, and older snapshots beyond --keep are removed." << endl;
+    cout << "Readers that opened an older snapshot keep reading it until they close it." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx snapshot planet.osmx /srv/replica --keep 2" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --keep N: keep the N newest snapshots. Defaults to 2." << endl;
+    exit(1);
+  }
+
+  string dir = result["dir"].as<string>();
+  string name = baseName(result["osmx"].as<string>());
+  int keep = std::max(1,result["keep"].as<int>());
+  string temp = dir + "/." + name + ".snapshot";
+  removeSnapshot(temp);
+
+  // DIR/NAME.osmx becomes a link, so it must not be a real file, such as the input itself.
+  struct stat st;
+  if (lstat((dir + "/" + name + ".osmx").c_str(),&st) == 0 && !S_ISLNK(st.st_mode)) {
+    cout << dir << "/" << name << ".osmx exists and is not a snapshot link; use another DIR." << endl;
+    exit(1);
+  }
+
+  {
+    Timer timer("snapshot");
+    MDB_env* env = db::createEnv(result["osmx"].as<string>(),false);
+    // the copy is made in its own read txn, so it is consistent even if an update commits meanwhile.
+    // compacting leaves out free pages and writes every table in key order.
+    CHECK(mdb_env_copy2(env,temp.c_str(),MDB_CP_COMPACT));
+    mdb_env_close(env);
+  }
+
+  // name the snapshot by the sequence number it was copied at.
+  string seqnum;
+  {
+    MDB_env* env = db::createEnv(temp,false);
+    MDB_txn* txn;
+    CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+    db::Metadata metadata(txn);
+    seqnum = metadata.get("osmosis_replication_sequence_number");
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+  }
+  if (seqnum.empty()) seqnum = "0";
+  string snapshot = name + "." + seqnum + ".osmx";
+  if (rename(temp.c_str(),(dir + "/" + snapshot).c_str()) != 0) {
+    perror("rename");
+    exit(1);
+  }
+  unlink((temp + "-lock").c_str());
+
+  // rename over the link, so readers opening NAME.osmx see either the old or the new snapshot.
+  string link = dir + "/" + name + ".osmx";
+  string temp_link = link + ".new";
+  unlink(temp_link.c_str());
+  if (symlink(snapshot.c_str(),temp_link.c_str()) != 0 || rename(temp_link.c_str(),link.c_str()) != 0) {
+    perror("symlink");
+    exit(1);
+  }
+  cout << "Snapshot: " << dir << "/" << snapshot << endl;
+
+  vector<pair<uint64_t,string>> snapshots;
+  DIR *d = opendir(dir.c_str());
+  if (!d) return;
+  string prefix = name + ".";
+  while (struct dirent *entry = readdir(d)) {
+    string file = entry->d_name;
+    if (file.size() <= prefix.size() + 5 || file.compare(0,prefix.size(),prefix) != 0) continue;
+    if (file.compare(file.size() - 5,5,".osmx") != 0) continue;
+    string number = file.substr(prefix.size(),file.size() - prefix.size() - 5);
+    if (number.find_first_not_of("0123456789") != string::npos) continue;
+    snapshots.emplace_back(stoull(number),file);
+  }
+  closedir(d);
+  std::sort(snapshots.begin(),snapshots.end(),std::greater<pair<uint64_t,string>>());
+  for (size_t i = keep; i < snapshots.size(); i++) {
+    if (snapshots[i].second == snapshot) continue;
+    removeSnapshot(dir + "/" + snapshots[i].second);
+    cout << "Removed: " << dir << "/" << snapshots[i].second << endl;
+  }
+}
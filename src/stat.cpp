@@ -0,0 +1,99 @@
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <sys/stat.h>
+#include "cxxopts.hpp"
+#include "osmx/storage.h"
+
+using namespace std;
+using namespace osmx;
+
+// the number of pages in the free list, as mdb_stat -f counts them:
+// each record of the free DB is a list of page numbers, preceded by its length.
+static uint64_t freePages(MDB_txn *txn, uint64_t &records) {
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(txn,0,&cursor));
+  MDB_val key, data;
+  uint64_t pages = 0;
+  records = 0;
+  while (mdb_cursor_get(cursor,&key,&data,MDB_NEXT) == 0) {
+    pages += *(size_t *)data.mv_data;
+    records++;
+  }
+  mdb_cursor_close(cursor);
+  return pages;
+}
+
+void cmdStat(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Stat", "Print table statistics of an .osmx file.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("osmx", "Input .osmx", cxxopts::value<string>())
+    ("detail", "Print pages, depth and free space of every table")
+  ;
+  cmdoptions.parse_positional({"cmd","osmx"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("osmx") == 0) {
+    cout << "Usage: osmx stat OSMX_FILE [--detail]" << endl;
+    cout << "Prints the entries in each table, like osmx query OSMX_FILE." << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --detail: also print the depth and branch, leaf and overflow pages of every table, and the size of the free list." << endl;
+    cout << "  A file that has grown much larger than its tables, or a long free list, is fragmented: see osmx compact." << endl;
+    exit(1);
+  }
+
+  string osmx = result["osmx"].as<string>();
+  MDB_env* env = db::createEnv(osmx);
+  MDB_txn* txn;
+  CHECK(mdb_txn_begin(env, NULL, MDB_RDONLY, &txn));
+
+  MDB_envinfo info;
+  MDB_stat env_stat;
+  CHECK(mdb_env_info(env,&info));
+  CHECK(mdb_env_stat(env,&env_stat));
+  uint64_t page_size = env_stat.ms_psize;
+
+  vector<string> tables = db::tableNames(txn);
+
+  bool detail = result.count("detail") > 0;
+  uint64_t table_pages = 0;
+  if (detail) {
+    cout << std::left << std::setw(22) << "table" << std::right << std::setw(14) << "entries" << std::setw(7) << "depth" << std::setw(12) << "branch" << std::setw(12) << "leaf" << std::setw(12) << "overflow" << std::setw(12) << "MB" << endl;
+  }
+  for (auto const &table : tables) {
+    MDB_dbi dbi;
+    if (mdb_dbi_open(txn,table.c_str(),0,&dbi) != 0) continue;
+    MDB_stat stat;
+    CHECK(mdb_stat(txn,dbi,&stat));
+    uint64_t pages = stat.ms_branch_pages + stat.ms_leaf_pages + stat.ms_overflow_pages;
+    table_pages += pages;
+    if (detail) {
+      cout << std::left << std::setw(22) << table << std::right << std::setw(14) << stat.ms_entries << std::setw(7) << stat.ms_depth << std::setw(12) << stat.ms_branch_pages << std::setw(12) << stat.ms_leaf_pages << std::setw(12) << stat.ms_overflow_pages << std::setw(12) << std::fixed << std::setprecision(1) << pages * page_size / 1000000.0 << endl;
+    } else {
+      cout << table << ": " << stat.ms_entries << endl;
+    }
+  }
+
+  if (detail) {
+    uint64_t free_records;
+    uint64_t free_pages = freePages(txn,free_records);
+    uint64_t used_pages = info.me_last_pgno + 1;
+    struct stat st;
+    uint64_t file_size = stat(osmx.c_str(),&st) == 0 ? st.st_size : 0;
+    cout << endl;
+    cout << "Page size: " << page_size << endl;
+    cout << "File size: " << file_size / 1000000.0 << " MB" << endl;
+    cout << "Used pages: " << used_pages << " (" << used_pages * page_size / 1000000.0 << " MB)" << endl;
+    cout << "Table pages: " << table_pages << " (" << table_pages * page_size / 1000000.0 << " MB)" << endl;
+    cout << "Free pages: " << free_pages << " in " << free_records << " free list entries (" << free_pages * page_size / 1000000.0 << " MB)" << endl;
+    cout << "Readers: " << info.me_numreaders << endl;
+    cout << "Last transaction: " << info.me_last_txnid << endl;
+  }
+
+  db::Metadata metadata(txn);
+  cout << "Timestamp: " << metadata.get("osmosis_replication_timestamp") << endl;
+  cout << "Sequence #: " << metadata.get("osmosis_replication_sequence_number") << endl;
+  mdb_txn_abort(txn);
+  mdb_env_close(env);
+}
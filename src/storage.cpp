@@ -1,9 +1,16 @@
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "osmx/storage.h"
 
 namespace osmx { namespace db {
 
 
-MDB_env *createEnv(std::string path, bool writable) {
+MDB_env *createEnv(std::string path, bool writable, int flags) {
   MDB_env* env;
   CHECK(mdb_env_create(&env));
 
@@ -11,13 +18,69 @@ MDB_env *createEnv(std::string path, bool writable) {
   // 2TB is a safe number for just OSM data as of 02/2023
   // only affects the size of virtual memory, not real memory.
   mdb_env_set_mapsize(env,2UL * 1024UL * 1024UL * 1024UL * 1024UL);
-  mdb_env_set_maxdbs(env,10);
-  int flags = 0;
+  // the 10 core tables, plus optional tables such as strings.
+  mdb_env_set_maxdbs(env,32);
   if (!writable) flags |= MDB_RDONLY;
   CHECK(mdb_env_open(env, path.c_str(),MDB_NOSUBDIR | MDB_NORDAHEAD | MDB_NOSYNC | flags, 0664));
   return env;
 }
 
+// the environment is a file in /dev/shm, which lives in memory, or the temp dir where there is none.
+// the file and its lock file are unlinked once opened, so the memory map is the only reference to them.
+MDB_env *createMemoryEnv(const std::string &source) {
+  struct stat st;
+  std::string dir = "/dev/shm";
+  if (stat(dir.c_str(),&st) != 0) dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+  std::string path = dir + "/osmx-XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  if (!source.empty()) {
+    MDB_env *sourceEnv = createEnv(source);
+    CHECK(mdb_env_copyfd2(sourceEnv,fd,MDB_CP_COMPACT));
+    mdb_env_close(sourceEnv);
+  }
+  close(fd);
+  MDB_env *env = createEnv(path,true);
+  unlink(path.c_str());
+  unlink((path + "-lock").c_str());
+  return env;
+}
+
+Env::~Env() {
+  mdb_env_close(mEnv);
+}
+
+void Env::sync() {
+  CHECK(mdb_env_sync(mEnv,1));
+}
+
+Txn::Txn(MDB_env *env, bool writable) : mEnv(env) {
+  CHECK(mdb_txn_begin(env, NULL, writable ? 0 : MDB_RDONLY, &mTxn));
+}
+
+Txn::~Txn() {
+  if (mTxn) mdb_txn_abort(mTxn);
+}
+
+void Txn::commit() {
+  CHECK(mdb_txn_commit(mTxn));
+  mTxn = nullptr;
+}
+
+void Txn::abort() {
+  mdb_txn_abort(mTxn);
+  mTxn = nullptr;
+}
+
+void Txn::restart() {
+  CHECK(mdb_txn_commit(mTxn));
+  mTxn = nullptr;
+  CHECK(mdb_txn_begin(mEnv, NULL, 0, &mTxn));
+}
+
 Metadata::Metadata(MDB_txn *txn) : mTxn(txn) {
   CHECK(mdb_dbi_open(mTxn, "metadata", MDB_CREATE, &mDbi));
 }
@@ -40,46 +103,302 @@ std::string Metadata::get(const std::string &key_str) {
     else return "";
 }
 
+StringTable::StringTable(MDB_txn *txn) : mTxn(txn) {
+  // databases created without a dictionary have no strings table.
+  int retval = mdb_dbi_open(txn, "strings", MDB_INTEGERKEY, &mDbi);
+  if (retval == MDB_NOTFOUND) return;
+  CHECK(retval);
+  MDB_stat stat;
+  CHECK(mdb_stat(txn,mDbi,&stat));
+  mSize = stat.ms_entries;
+}
+
+void StringTable::create(MDB_txn *txn, const std::vector<std::string> &strings) {
+  MDB_dbi dbi;
+  CHECK(mdb_dbi_open(txn, "strings", MDB_INTEGERKEY | MDB_CREATE, &dbi));
+  for (uint64_t code = 1; code <= strings.size(); code++) {
+    MDB_val key, data;
+    key.mv_size = sizeof(uint64_t);
+    key.mv_data = (void *)&code;
+    data.mv_size = strings[code - 1].size();
+    data.mv_data = (void *)strings[code - 1].data();
+    CHECK(mdb_put(txn, dbi, &key, &data, MDB_APPEND));
+  }
+}
+
+// the values are not null terminated, so each is copied once into mStrings.
+const char *StringTable::get(uint32_t code) const {
+  auto found = mStrings.find(code);
+  if (found != mStrings.end()) return found->second.c_str();
+  uint64_t k = code;
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&k;
+  CHECK(mdb_get(mTxn,mDbi,&key,&data));
+  return mStrings.emplace(code,std::string((const char *)data.mv_data,data.mv_size)).first->second.c_str();
+}
+
+uint32_t StringTable::code(const char *str) const {
+  if (mSize == 0) return 0;
+  if (mCodes.empty()) {
+    MDB_cursor *cursor;
+    MDB_val key, data;
+    CHECK(mdb_cursor_open(mTxn,mDbi,&cursor));
+    while (mdb_cursor_get(cursor,&key,&data,MDB_NEXT) == 0) {
+      uint32_t c = *(uint64_t *)key.mv_data;
+      auto it = mStrings.find(c);
+      if (it == mStrings.end()) it = mStrings.emplace(c,std::string((const char *)data.mv_data,data.mv_size)).first;
+      mCodes.emplace(it->second.c_str(),c);
+    }
+    mdb_cursor_close(cursor);
+  }
+  auto found = mCodes.find(str);
+  if (found == mCodes.end()) return 0;
+  return found->second;
+}
+
+void setNodes(Way::Builder way, const osmium::WayNodeList &nodes, bool packed) {
+  if (!packed) {
+    auto nodesBuilder = way.initNodes(nodes.size());
+    for (unsigned int i = 0; i < nodes.size(); i++) nodesBuilder.set(i,nodes[i].ref());
+    return;
+  }
+
+  // at most 10 bytes per varint.
+  std::vector<kj::byte> buf(nodes.size() * 10);
+  kj::byte *p = buf.data();
+  int64_t prev = 0;
+  for (auto const &node_ref : nodes) {
+    int64_t delta = node_ref.ref() - prev;
+    prev = node_ref.ref();
+    uint64_t v = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    while (v >= 0x80) {
+      *p++ = (kj::byte)(v | 0x80);
+      v >>= 7;
+    }
+    *p++ = (kj::byte)v;
+  }
+  way.setPackedNodes(kj::arrayPtr(buf.data(),p));
+}
+
+// a point lookup, through the cursor if there is one.
+// LMDB first searches the leaf page the cursor is on, so nearby keys don't descend from the root.
+static int lookup(MDB_txn *txn, MDB_dbi dbi, MDB_cursor *cursor, MDB_val *key, MDB_val *data) {
+  if (cursor) return mdb_cursor_get(cursor,key,data,MDB_SET_KEY);
+  return mdb_get(txn,dbi,key,data);
+}
+
 Elements::Elements(MDB_txn *txn, const std::string &name) : mTxn(txn) {
-  CHECK(mdb_dbi_open(txn, name.c_str(), MDB_INTEGERKEY | MDB_CREATE, &mDbi));
+  // files expanded with --cluster have a position table for each element table.
+  int retval = mdb_dbi_open(txn, (name + "_position").c_str(), MDB_INTEGERKEY, &mPositions);
+  if (retval == 0) {
+    mClustered = true;
+    CHECK(mdb_dbi_open(txn, (name + "_clustered").c_str(), MDB_INTEGERKEY, &mDbi));
+  } else {
+    if (retval != MDB_NOTFOUND) CHECK(retval);
+    CHECK(mdb_dbi_open(txn, name.c_str(), MDB_INTEGERKEY | MDB_CREATE, &mDbi));
+  }
+  Metadata metadata(txn);
+  mPacked = metadata.get("element_encoding") == "packed";
 }
 
-void Elements::put(uint64_t id, kj::VectorOutputStream &vos, int flags) {
+// the key of the value for id, which is the id itself unless the table is clustered.
+bool Elements::find(uint64_t id, uint64_t &position) {
+  if (!mClustered) {
+    position = id;
+    return true;
+  }
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
   key.mv_data = (void *)&id;
-  data.mv_size = vos.getArray().size();
-  data.mv_data = (void *)vos.getArray().begin();
+  int retval = lookup(mTxn,mPositions,mPositionCursor,&key,&data);
+  if (retval == MDB_NOTFOUND) return false;
+  CHECK(retval);
+  position = *(uint64_t *)data.mv_data;
+  return true;
+}
+
+uint64_t clusterPosition(S2CellId cell, uint64_t id) {
+  if (id >= CLUSTER_MAX_ID) {
+    printf("Can't position id %llu in a clustered table, ids must be below 2^35, file %s, line %d.\n", (unsigned long long)id, __FILE__, __LINE__);
+    abort();
+  }
+  if (!cell.is_valid()) return id;
+  return ((cell.parent(13).id() >> 35) << 35) | id;
+}
+
+void Elements::put(uint64_t id, kj::VectorOutputStream &vos, int flags) {
+  uint64_t position;
+  if (!find(id,position)) {
+    // new elements in a clustered table are positioned by id alone.
+    position = clusterPosition(S2CellId(),id);
+    MDB_val key, data;
+    key.mv_size = sizeof(uint64_t);
+    key.mv_data = (void *)&id;
+    data.mv_size = sizeof(uint64_t);
+    data.mv_data = (void *)&position;
+    CHECK(mdb_put(mTxn, mPositions, &key, &data, 0));
+  }
+
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&position;
+  kj::VectorOutputStream packed_vos;
+  auto arr = vos.getArray();
+  if (mPacked) {
+    // the flat message is read again for its segments, which writePackedMessage takes.
+    capnp::FlatArrayMessageReader reader(kj::arrayPtr((const capnp::word *)arr.begin(),arr.size() / sizeof(capnp::word)));
+    kj::Vector<kj::ArrayPtr<const capnp::word>> segments;
+    for (uint32_t i = 0; reader.getSegment(i) != nullptr; i++) segments.add(reader.getSegment(i));
+    capnp::writePackedMessage(packed_vos,segments.asPtr());
+    arr = packed_vos.getArray();
+  }
+  data.mv_size = arr.size();
+  data.mv_data = (void *)arr.begin();
   CHECK(mdb_put(mTxn, mDbi, &key, &data, flags));
 }
 
 void Elements::del(uint64_t id) {
+  uint64_t position;
+  if (!find(id,position)) return;
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
-  key.mv_data = (void *)&id;
+  key.mv_data = (void *)&position;
   mdb_del(mTxn, mDbi, &key, &data);
+  if (mClustered) {
+    key.mv_data = (void *)&id;
+    mdb_del(mTxn, mPositions, &key, &data);
+  }
+}
+
+// deletes the entries of an integer keyed table with keys above after.
+static void truncateTable(MDB_txn *txn, MDB_dbi dbi, uint64_t after) {
+  if (after == UINT64_MAX) return;
+  uint64_t first = after + 1;
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&first;
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(txn,dbi,&cursor));
+  // after a delete, MDB_NEXT returns the entry that followed the deleted one.
+  int retval = mdb_cursor_get(cursor,&key,&data,MDB_SET_RANGE);
+  while (retval == 0) {
+    CHECK(mdb_cursor_del(cursor,0));
+    retval = mdb_cursor_get(cursor,&key,&data,MDB_NEXT);
+  }
+  if (retval != MDB_NOTFOUND) CHECK(retval);
+  mdb_cursor_close(cursor);
+}
+
+void Elements::truncate(uint64_t after) {
+  truncateTable(mTxn,mDbi,after);
 }
 
 bool Elements::exists(uint64_t id) {
+  uint64_t position;
+  if (!find(id,position)) return false;
+  if (mClustered) return true;
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
-  key.mv_data = (void *)&id;
-  return mdb_get(mTxn,mDbi,&key,&data) == 0;
+  key.mv_data = (void *)&position;
+  return lookup(mTxn,mDbi,mCursor,&key,&data) == 0;
 }
 
-capnp::FlatArrayMessageReader Elements::getReader(uint64_t id) {
+ElementReader Elements::getReader(uint64_t id) {
+  uint64_t position;
+  if (!find(id,position)) CHECK(MDB_NOTFOUND);
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
-  key.mv_data = (void *)&id;
-  CHECK(mdb_get(mTxn,mDbi,&key,&data));
-  auto arr = kj::ArrayPtr<const capnp::word>((const capnp::word *)data.mv_data,data.mv_size);
-  return capnp::FlatArrayMessageReader(arr);
+  key.mv_data = (void *)&position;
+  CHECK(lookup(mTxn,mDbi,mCursor,&key,&data));
+  return read(data);
+}
+
+kj::Maybe<ElementReader> Elements::tryGet(uint64_t id) {
+  uint64_t position;
+  if (!find(id,position)) return nullptr;
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&position;
+  int retval = lookup(mTxn,mDbi,mCursor,&key,&data);
+  if (retval == MDB_NOTFOUND) return nullptr;
+  CHECK(retval);
+  return read(data);
+}
+
+ElementCursor::ElementCursor(MDB_txn *txn, const std::string &name) : Elements(txn,name) {
+  CHECK(mdb_cursor_open(mTxn,mDbi,&mCursor));
+  if (mClustered) CHECK(mdb_cursor_open(mTxn,mPositions,&mPositionCursor));
+}
+
+ElementCursor::~ElementCursor() {
+  mdb_cursor_close(mCursor);
+  if (mPositionCursor) mdb_cursor_close(mPositionCursor);
+}
+
+bool ElementCursor::next(uint64_t &id) {
+  MDB_val key, data;
+  if (mdb_cursor_get(mClustered ? mPositionCursor : mCursor,&key,&data,MDB_NEXT) != 0) return false;
+  id = *(uint64_t *)key.mv_data;
+  return true;
+}
+
+ElementReader Elements::read(const MDB_val &data) {
+  if (!mPacked) {
+    return ElementReader(kj::ArrayPtr<const capnp::word>((const capnp::word *)data.mv_data,data.mv_size / sizeof(capnp::word)));
+  }
+  return ElementReader(kj::arrayPtr((const kj::byte *)data.mv_data,data.mv_size));
 }
 
 Locations::Locations(MDB_txn *txn) : mTxn(txn) {
     CHECK(mdb_dbi_open(mTxn, "locations", MDB_INTEGERKEY | MDB_CREATE, &mDbi));
 }
 
+LocationCursor::LocationCursor(MDB_txn *txn) : Locations(txn) {
+  CHECK(mdb_cursor_open(mTxn,mDbi,&mCursor));
+}
+
+LocationCursor::~LocationCursor() {
+  mdb_cursor_close(mCursor);
+}
+
+bool LocationCursor::next(uint64_t &id, Location &location) {
+  MDB_val key, data;
+  if (mdb_cursor_get(mCursor,&key,&data,MDB_NEXT) != 0) return false;
+  id = *(uint64_t *)key.mv_data;
+  int32_t *buf = (int32_t *)data.mv_data;
+  location = Location{osmium::Location(buf[0],buf[1]),buf[2]};
+  return true;
+}
+
+ClusterWriter::ClusterWriter(MDB_txn *txn, const std::string &name) : mTxn(txn) {
+  CHECK(mdb_dbi_open(txn, name.c_str(), MDB_INTEGERKEY, &mSource));
+  CHECK(mdb_dbi_open(txn, (name + "_position").c_str(), MDB_INTEGERKEY | MDB_CREATE, &mPositions));
+  CHECK(mdb_dbi_open(txn, (name + "_clustered").c_str(), MDB_INTEGERKEY | MDB_CREATE, &mClustered));
+}
+
+void ClusterWriter::putPosition(uint64_t id, uint64_t position) {
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&id;
+  data.mv_size = sizeof(uint64_t);
+  data.mv_data = (void *)&position;
+  CHECK(mdb_put(mTxn, mPositions, &key, &data, MDB_APPEND));
+}
+
+void ClusterWriter::copy(uint64_t position, uint64_t id) {
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&id;
+  CHECK(mdb_get(mTxn, mSource, &key, &data));
+  key.mv_data = (void *)&position;
+  CHECK(mdb_put(mTxn, mClustered, &key, &data, MDB_APPEND));
+}
+
+void ClusterWriter::dropSource() {
+  CHECK(mdb_drop(mTxn, mSource, 0));
+}
+
 void Locations::put(uint64_t id, const Location value, int flags) {
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
@@ -106,18 +425,22 @@ Location Locations::get(uint64_t id) const {
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
   key.mv_data = (void *)&id;
-  int retval = mdb_get(mTxn, mDbi, &key, &data);
+  int retval = lookup(mTxn,mDbi,mCursor,&key,&data);
   if (retval == MDB_NOTFOUND) return Location{};
   CHECK(retval);
   int32_t *buf = (int32_t *)data.mv_data;
   return Location{osmium::Location(buf[0],buf[1]),buf[2]};
 }
 
+void Locations::truncate(uint64_t after) {
+  truncateTable(mTxn,mDbi,after);
+}
+
 bool Locations::exists(uint64_t id) {
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
   key.mv_data = (void *)&id;
-  int retval = mdb_get(mTxn, mDbi, &key, &data);
+  int retval = lookup(mTxn,mDbi,mCursor,&key,&data);
   return retval != MDB_NOTFOUND;
 }
 
@@ -143,9 +466,265 @@ void Index::del(uint64_t from, uint64_t osm_id ) {
   mdb_del(mTxn,mDbi,&key,&data);
 }
 
-IndexWriter::IndexWriter(MDB_env *env, const std::string &name) : mEnv(env), mName(name) {
-  CHECK(mdb_txn_begin(env, NULL, 0, &mTxn));
+CellCounts::CellCounts(MDB_txn *txn) : mTxn(txn) {
+  int retval = mdb_dbi_open(txn, "cell_count", MDB_INTEGERKEY, &mDbi);
+  mPresent = retval != MDB_NOTFOUND;
+  if (mPresent) CHECK(retval);
+}
+
+void CellCounts::create(MDB_txn *txn, const std::unordered_map<uint64_t,uint64_t> &counts) {
+  MDB_dbi dbi;
+  CHECK(mdb_dbi_open(txn, "cell_count", MDB_INTEGERKEY | MDB_CREATE, &dbi));
+  std::vector<std::pair<uint64_t,uint64_t>> sorted(counts.begin(),counts.end());
+  std::sort(sorted.begin(),sorted.end());
+  for (auto &entry : sorted) {
+    MDB_val key, data;
+    key.mv_size = sizeof(uint64_t);
+    key.mv_data = (void *)&entry.first;
+    data.mv_size = sizeof(uint64_t);
+    data.mv_data = (void *)&entry.second;
+    CHECK(mdb_put(txn,dbi,&key,&data,MDB_APPEND));
+  }
+}
+
+void CellCounts::add(S2CellId cell, int64_t delta) {
+  if (!mPresent) return;
+  uint64_t id = cell.parent(CELL_COUNT_LEVEL).id();
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&id;
+  uint64_t count = 0;
+  int retval = mdb_get(mTxn,mDbi,&key,&data);
+  if (retval != MDB_NOTFOUND) {
+    CHECK(retval);
+    count = *(uint64_t *)data.mv_data;
+  }
+  count = (delta < 0 && count < (uint64_t)-delta) ? 0 : count + delta;
+  if (count == 0) {
+    mdb_del(mTxn,mDbi,&key,NULL);
+    return;
+  }
+  data.mv_size = sizeof(uint64_t);
+  data.mv_data = (void *)&count;
+  CHECK(mdb_put(mTxn,mDbi,&key,&data,0));
+}
+
+uint64_t CellCounts::count(S2CellId cell) {
+  S2CellId start = cell.child_begin(CELL_COUNT_LEVEL);
+  S2CellId end = cell.child_end(CELL_COUNT_LEVEL);
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(mTxn,mDbi,&cursor));
+  MDB_val key, data;
+  key.mv_size = sizeof(S2CellId);
+  key.mv_data = (void *)&start;
+  uint64_t total = 0;
+  int retval = mdb_cursor_get(cursor,&key,&data,MDB_SET_RANGE);
+  while (retval == 0 && *((S2CellId *)key.mv_data) < end) {
+    total += *(uint64_t *)data.mv_data;
+    retval = mdb_cursor_get(cursor,&key,&data,MDB_NEXT);
+  }
+  mdb_cursor_close(cursor);
+  return total;
+}
+
+Changelog::Changelog(MDB_txn *txn, bool create) : mTxn(txn) {
+  int retval = mdb_dbi_open(txn, "changelog", MDB_INTEGERKEY | (create ? MDB_CREATE : 0), &mDbi);
+  mPresent = retval != MDB_NOTFOUND;
+  if (mPresent) CHECK(retval);
+}
+
+// the value is the three bitmaps in the portable roaring format, each preceded by its size.
+void Changelog::put(uint64_t seqnum, ChangeSet &changes) {
+  Roaring64Map *bitmaps[] = {&changes.nodes,&changes.ways,&changes.relations};
+  size_t total = 0;
+  for (auto bitmap : bitmaps) {
+    bitmap->runOptimize();
+    total += sizeof(uint64_t) + bitmap->getSizeInBytes();
+  }
+  std::vector<char> buf(total);
+  char *p = buf.data();
+  for (auto bitmap : bitmaps) {
+    uint64_t size = bitmap->getSizeInBytes();
+    memcpy(p,&size,sizeof(uint64_t));
+    p += sizeof(uint64_t);
+    p += bitmap->write(p);
+  }
+
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&seqnum;
+  data.mv_size = buf.size();
+  data.mv_data = (void *)buf.data();
+  CHECK(mdb_put(mTxn,mDbi,&key,&data,0));
+}
+
+uint64_t Changelog::get(uint64_t from, uint64_t to, ChangeSet &changes) {
+  if (!mPresent) return 0;
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(mTxn,mDbi,&cursor));
+  uint64_t start = from + 1;
+  MDB_val key, data;
+  key.mv_size = sizeof(uint64_t);
+  key.mv_data = (void *)&start;
+  uint64_t found = 0;
+  int retval = mdb_cursor_get(cursor,&key,&data,MDB_SET_RANGE);
+  while (retval == 0 && *(uint64_t *)key.mv_data <= to) {
+    Roaring64Map *bitmaps[] = {&changes.nodes,&changes.ways,&changes.relations};
+    const char *p = (const char *)data.mv_data;
+    for (auto bitmap : bitmaps) {
+      uint64_t size;
+      memcpy(&size,p,sizeof(uint64_t));
+      p += sizeof(uint64_t);
+      *bitmap |= Roaring64Map::readSafe(p,size);
+      p += size;
+    }
+    found++;
+    retval = mdb_cursor_get(cursor,&key,&data,MDB_NEXT);
+  }
+  mdb_cursor_close(cursor);
+  return found;
+}
+
+TagIndex::TagIndex(MDB_txn *txn) : mTxn(txn) {
+  mMaxKeySize = mdb_env_get_maxkeysize(mdb_txn_env(txn));
+  int retval = mdb_dbi_open(txn, "tag_index", 0, &mDbi);
+  mPresent = retval != MDB_NOTFOUND;
+  if (!mPresent) return;
+  CHECK(retval);
+  Metadata metadata(txn);
+  std::istringstream keys(metadata.get("tag_index"));
+  std::string key;
+  while (std::getline(keys,key,',')) {
+    if (!key.empty()) mKeys.insert(key);
+  }
+}
+
+void TagIndex::create(MDB_txn *txn, const std::vector<std::string> &keys) {
+  MDB_dbi dbi;
+  CHECK(mdb_dbi_open(txn, "tag_index", MDB_CREATE, &dbi));
+  std::string joined;
+  for (auto const &key : keys) {
+    if (!joined.empty()) joined += ",";
+    joined += key;
+  }
+  Metadata metadata(txn);
+  metadata.put("tag_index",joined);
+}
+
+// values too long for an LMDB key are truncated and end in "#" and a 64 bit FNV-1a hash of the whole value,
+// so they stay under the "n/KEY=" prefix of their key.
+std::string TagIndex::valueKey(osmium::item_type type, const std::string &key, const std::string &value) const {
+  char prefix = type == osmium::item_type::node ? 'n' : type == osmium::item_type::way ? 'w' : 'r';
+  std::string k = std::string(1,prefix) + "/" + key + "=" + value;
+  // room for the zero byte and the block.
+  size_t max = mMaxKeySize - 5;
+  if (k.size() <= max) return k;
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  char suffix[18];
+  snprintf(suffix,sizeof(suffix),"#%016llx",(unsigned long long)hash);
+  return k.substr(0,max - 17) + suffix;
+}
+
+// the block is big endian, so the blocks of a value are in id order.
+std::string TagIndex::tableKey(const std::string &valueKey, uint64_t id) {
+  uint32_t block = id / TAG_INDEX_BLOCK;
+  std::string k = valueKey;
+  k.push_back('\0');
+  for (int shift = 24; shift >= 0; shift -= 8) k.push_back((char)(block >> shift));
+  return k;
+}
+
+static uint64_t keyBlock(const MDB_val &k) {
+  const unsigned char *p = (const unsigned char *)k.mv_data + k.mv_size - 4;
+  return ((uint64_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static Roaring64Map readBitmap(const MDB_val &data) {
+  return Roaring64Map::readSafe((const char *)data.mv_data,data.mv_size);
+}
+
+void TagIndex::add(osmium::item_type type, const char *key, const char *value, uint64_t id) {
+  if (!mPresent || !indexes(key)) return;
+  auto k = tableKey(valueKey(type,key,value),id);
+  mAdded[k].add(id);
+  mBuffered++;
+  auto removed = mRemoved.find(k);
+  if (removed != mRemoved.end()) removed->second.remove(id);
+}
+
+void TagIndex::add(osmium::item_type type, const osmium::TagList &tags, uint64_t id) {
+  for (auto const &tag : tags) add(type,tag.key(),tag.value(),id);
+}
+
+void TagIndex::remove(osmium::item_type type, const char *key, const char *value, uint64_t id) {
+  if (!mPresent || !indexes(key)) return;
+  auto k = tableKey(valueKey(type,key,value),id);
+  mRemoved[k].add(id);
+  mBuffered++;
+  auto added = mAdded.find(k);
+  if (added != mAdded.end()) added->second.remove(id);
+}
+
+void TagIndex::flush() {
+  std::set<std::string> changed;
+  for (auto const &entry : mAdded) changed.insert(entry.first);
+  for (auto const &entry : mRemoved) changed.insert(entry.first);
+
+  for (auto const &k : changed) {
+    MDB_val key, data;
+    key.mv_size = k.size();
+    key.mv_data = (void *)k.data();
+    Roaring64Map bitmap;
+    if (mdb_get(mTxn,mDbi,&key,&data) == 0) bitmap = readBitmap(data);
+    auto added = mAdded.find(k);
+    if (added != mAdded.end()) bitmap |= added->second;
+    auto removed = mRemoved.find(k);
+    if (removed != mRemoved.end()) bitmap -= removed->second;
+
+    if (bitmap.isEmpty()) {
+      int retval = mdb_del(mTxn,mDbi,&key,NULL);
+      if (retval != MDB_NOTFOUND) CHECK(retval);
+      continue;
+    }
+    bitmap.runOptimize();
+    std::vector<char> buf(bitmap.getSizeInBytes());
+    bitmap.write(buf.data());
+    data.mv_size = buf.size();
+    data.mv_data = (void *)buf.data();
+    CHECK(mdb_put(mTxn,mDbi,&key,&data,0));
+  }
+  mAdded.clear();
+  mRemoved.clear();
+  mBuffered = 0;
+}
+
+void TagIndex::get(osmium::item_type type, const std::string &key, bool anyValue, const std::string &value, const Roaring64Map &within, Roaring64Map &ids) {
+  if (!mPresent || within.isEmpty()) return;
+  // all blocks of a value are adjacent, after "n/KEY=VALUE" and the zero byte, and all values of a key after "n/KEY=".
+  auto prefix = anyValue ? valueKey(type,key,"") : valueKey(type,key,value) + std::string(1,'\0');
+  MDB_val k, data;
+  k.mv_size = prefix.size();
+  k.mv_data = (void *)prefix.data();
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(mTxn,mDbi,&cursor));
+  int retval = mdb_cursor_get(cursor,&k,&data,MDB_SET_RANGE);
+  while (retval == 0 && k.mv_size >= prefix.size() + 5 && memcmp(k.mv_data,prefix.data(),prefix.size()) == 0) {
+    uint64_t start = keyBlock(k) * TAG_INDEX_BLOCK;
+    uint64_t before = start == 0 ? 0 : within.rank(start - 1);
+    if (within.rank(start + TAG_INDEX_BLOCK - 1) > before) ids |= readBitmap(data) & within;
+    retval = mdb_cursor_get(cursor,&k,&data,MDB_NEXT);
+  }
+  mdb_cursor_close(cursor);
+}
+
+IndexWriter::IndexWriter(MDB_env *env, const std::string &name) : mTxn(env,true), mName(name) {
   CHECK(mdb_dbi_open(mTxn, name.c_str(), MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &mDbi));
+  // a resumed expand may find the entries of an interrupted write.
+  CHECK(mdb_drop(mTxn, mDbi, 0));
 }
 
 void IndexWriter::put(uint64_t from, uint64_t osm_id, int flags) {
@@ -156,27 +735,28 @@ void IndexWriter::put(uint64_t from, uint64_t osm_id, int flags) {
   data.mv_data = (void *)&osm_id;
   CHECK(mdb_put(mTxn,mDbi,&key,&data,flags));
   if (mWrites++ == 8000000) {
-    CHECK(mdb_txn_commit(mTxn));
-    CHECK(mdb_txn_begin(mEnv, NULL, 0, &mTxn));
+    mTxn.restart();
     CHECK(mdb_dbi_open(mTxn, mName.c_str(), MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &mDbi));
     mWrites = 0;
   }
 }
 
 void IndexWriter::commit() {
-  CHECK(mdb_txn_commit(mTxn));
+  mTxn.commit();
 }
 
 void traverseCell(MDB_cursor *cursor,S2CellId cell_id,Roaring64Map &set) {
-  S2CellId start = cell_id.child_begin(CELL_INDEX_LEVEL);
-  S2CellId end = cell_id.child_end(CELL_INDEX_LEVEL);
+  traverseRange(cursor,cell_id.child_begin(CELL_INDEX_LEVEL).id(),cell_id.child_end(CELL_INDEX_LEVEL).id(),set);
+}
+
+void traverseRange(MDB_cursor *cursor,uint64_t start,uint64_t end,Roaring64Map &set) {
   MDB_val key, data;
-  key.mv_size = sizeof(S2CellId);
+  key.mv_size = sizeof(uint64_t);
   key.mv_data = (void *)&start;
 
   // reading past end of db
   if (mdb_cursor_get(cursor,&key,&data,MDB_SET_RANGE) != 0) return;
-  while (*((S2CellId *)key.mv_data) < end) {
+  while (*((uint64_t *)key.mv_data) < end) {
     int retval_values = mdb_cursor_get(cursor,&key,&data,MDB_GET_MULTIPLE);
     while (0 == retval_values) {
       for (int i = 0; i < data.mv_size/sizeof(uint64_t); i++) {
@@ -190,6 +770,58 @@ void traverseCell(MDB_cursor *cursor,S2CellId cell_id,Roaring64Map &set) {
   }
 }
 
+uint64_t countCell(MDB_cursor *cursor,S2CellId cell_id) {
+  S2CellId start = cell_id.child_begin(CELL_INDEX_LEVEL);
+  S2CellId end = cell_id.child_end(CELL_INDEX_LEVEL);
+  MDB_val key, data;
+  key.mv_size = sizeof(S2CellId);
+  key.mv_data = (void *)&start;
+  uint64_t total = 0;
+
+  if (mdb_cursor_get(cursor,&key,&data,MDB_SET_RANGE) != 0) return 0;
+  while (*((S2CellId *)key.mv_data) < end) {
+    size_t count;
+    CHECK(mdb_cursor_count(cursor,&count));
+    total += count;
+    if (mdb_cursor_get(cursor,&key,&data,MDB_NEXT_NODUP) != 0) break;
+  }
+  return total;
+}
+
+IndexCursor::IndexCursor(MDB_txn *txn, const std::string &name) {
+  MDB_dbi dbi;
+  CHECK(mdb_dbi_open(txn, name.c_str(), MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP, &dbi));
+  CHECK(mdb_cursor_open(txn,dbi,&mCursor));
+}
+
+IndexCursor::~IndexCursor() {
+  mdb_cursor_close(mCursor);
+}
+
+std::vector<std::string> tableNames(MDB_txn *txn) {
+  std::vector<std::string> tables;
+  MDB_dbi main;
+  CHECK(mdb_dbi_open(txn,NULL,0,&main));
+  MDB_cursor *cursor;
+  CHECK(mdb_cursor_open(txn,main,&cursor));
+  MDB_val key, data;
+  while (mdb_cursor_get(cursor,&key,&data,MDB_NEXT_NODUP) == 0) {
+    tables.emplace_back((const char *)key.mv_data,key.mv_size);
+  }
+  mdb_cursor_close(cursor);
+  return tables;
+}
+
+uint64_t tableEntries(MDB_txn *txn, const std::string &table) {
+  MDB_dbi dbi;
+  if (mdb_dbi_open(txn, (table + "_position").c_str(), MDB_INTEGERKEY, &dbi) != 0) {
+    if (mdb_dbi_open(txn, table.c_str(), MDB_INTEGERKEY, &dbi) != 0) return 0;
+  }
+  MDB_stat stat;
+  CHECK(mdb_stat(txn,dbi,&stat));
+  return stat.ms_entries;
+}
+
 void traverseReverse(MDB_cursor *cursor,uint64_t from, Roaring64Map &set) {
   MDB_val key, data;
   key.mv_size = sizeof(uint64_t);
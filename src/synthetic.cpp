@@ -0,0 +1,524 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "osmium/io/any_output.hpp"
+#include "osmium/memory/callback_buffer.hpp"
+#include "osmium/builder/osm_object_builder.hpp"
+#include "cxxopts.hpp"
+#include "osmx/util.h"
+#include "osmx/synthetic.h"
+
+using namespace std;
+
+typedef vector<pair<string,string>> Tags;
+typedef vector<pair<osmium::item_type,uint64_t>> Members;
+
+static const char *BASE_TIMESTAMP = "2020-01-01T00:00:00Z";
+static const char *CHANGE_TIMESTAMP = "2020-01-02T00:00:00Z";
+
+// the std distributions differ between standard libraries, so they are computed from the raw engine output.
+class Random {
+  public:
+  Random(uint64_t seed) : mEngine(seed) { }
+
+  double uniform() {
+    return (mEngine() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  uint64_t below(uint64_t n) {
+    return mEngine() % n;
+  }
+
+  // the number of failures before the first success, with success probability p.
+  uint64_t geometric(double p) {
+    if (p >= 1) return 0;
+    return (uint64_t)floor(log(1 - uniform()) / log(1 - p));
+  }
+
+  double normal() {
+    double u1 = 1 - uniform();
+    double u2 = uniform();
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+  }
+
+  // an index below n where small indexes are much more likely, like the frequency of names or users.
+  uint64_t skewed(uint64_t n, double power) {
+    return (uint64_t)(pow(uniform(),power) * n);
+  }
+
+  private:
+  std::mt19937_64 mEngine;
+};
+
+// a value in [0,1) that depends only on id and salt, used to pick the elements a change touches.
+static double hashFraction(uint64_t id, uint64_t salt) {
+  uint64_t z = id + salt * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+  return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+struct Element {
+  uint64_t id;
+  uint32_t uid;
+  Tags tags;
+};
+
+class Model {
+  public:
+  Model(const SyntheticOptions &options) : mOptions(options), mRandom(options.seed) {
+    for (int i = 0; i < max(options.clusters,1); i++) {
+      double lon = options.bounds.left() + mRandom.uniform() * (options.bounds.right() - options.bounds.left());
+      double lat = options.bounds.bottom() + mRandom.uniform() * (options.bounds.top() - options.bounds.bottom());
+      mCenters.emplace_back(lon,lat);
+    }
+    mRadius = (options.bounds.right() - options.bounds.left()) / sqrt(max(options.clusters,1)) / 4;
+  }
+
+  // calls handler.node(element,location), handler.way(element,node_ids) and handler.relation(element,members)
+  // in the order they are generated. elements only refer to elements generated before them.
+  template <typename H>
+  void run(H &handler) {
+    uint64_t nodes = 0;
+    uint64_t way_id = 0;
+    uint64_t relation_id = 0;
+    uint64_t last_node_id = 0;
+    osmium::Location last_location;
+    int depth = max(mOptions.relationDepth,0);
+    vector<vector<uint64_t>> levels(depth + 1);
+    vector<uint64_t> group_sizes(depth + 1,2);
+
+    while (nodes < mOptions.nodes) {
+      if (mRandom.uniform() < 0.1) {
+        uint64_t id = nextNodeId();
+        Element poi = element(id,poiTags());
+        handler.node(poi,clusterPoint());
+        nodes++;
+        continue;
+      }
+
+      double r = mRandom.uniform();
+      bool building = r < 0.3;
+      bool landuse = !building && r < 0.4;
+      vector<uint64_t> refs;
+      osmium::Location location;
+
+      // roads usually start at the end of the previous road.
+      if (!building && !landuse && last_node_id && mRandom.uniform() < 0.3) {
+        refs.push_back(last_node_id);
+        location = last_location;
+      } else {
+        location = clusterPoint();
+        refs.push_back(nextNodeId());
+        handler.node(element(refs.back(),Tags()),location);
+        nodes++;
+      }
+
+      uint64_t length = building ? 4 : 2 + mRandom.geometric(1 / max(mOptions.wayLength - 1,1.0));
+      length = min(length,(uint64_t)2000);
+      double step = building ? 0.0001 : 0.0003;
+      while (refs.size() < length) {
+        location = osmium::Location{clamp(location.lon() + mRandom.normal() * step,-180,180),clamp(location.lat() + mRandom.normal() * step,-90,90)};
+        refs.push_back(nextNodeId());
+        handler.node(element(refs.back(),Tags()),location);
+        nodes++;
+      }
+      if (building || landuse) refs.push_back(refs.front());
+      last_node_id = refs.back();
+      last_location = location;
+
+      Tags tags = building ? buildingTags() : landuse ? landuseTags() : highwayTags();
+      handler.way(element(++way_id,tags),refs);
+
+      // group ways into relations, and relations into relations, up to the depth.
+      levels[0].push_back(way_id);
+      for (int d = 0; d < depth; d++) {
+        if (levels[d].size() < group_sizes[d]) break;
+        if (d > 0 || mRandom.uniform() < 0.3) {
+          Members members;
+          for (auto ref : levels[d]) members.emplace_back(d == 0 ? osmium::item_type::way : osmium::item_type::relation,ref);
+          Tags relation_tags{{"type",d == 0 ? "route" : "route_master"},{"name",name("Route ")}};
+          handler.relation(element(++relation_id,relation_tags),members);
+          levels[d + 1].push_back(relation_id);
+        }
+        levels[d].clear();
+        group_sizes[d] = 2 + mRandom.below(10);
+      }
+      levels[depth].clear();
+    }
+  }
+
+  private:
+  uint64_t nextNodeId() {
+    mNodeId += 1 + mRandom.geometric(1 / max(mOptions.idGap,1.0));
+    return mNodeId;
+  }
+
+  Element element(uint64_t id, Tags tags) {
+    return Element{id,(uint32_t)(1 + mRandom.skewed(100000,3)),tags};
+  }
+
+  osmium::Location clusterPoint() {
+    auto center = mCenters[mRandom.skewed(mCenters.size(),3)];
+    return osmium::Location{clamp(center.lon() + mRandom.normal() * mRadius,-180,180),clamp(center.lat() + mRandom.normal() * mRadius,-90,90)};
+  }
+
+  static double clamp(double value, double lo, double hi) {
+    return max(lo,min(hi,value));
+  }
+
+  string name(const char *prefix) {
+    return prefix + to_string(mRandom.skewed(100000,4));
+  }
+
+  Tags poiTags() {
+    static const char *amenities[] = {"restaurant","cafe","bench","parking","school","pharmacy"};
+    Tags tags{{"amenity",amenities[mRandom.skewed(6,2)]}};
+    if (mRandom.uniform() < 0.5) tags.emplace_back("name",name("Place "));
+    return tags;
+  }
+
+  Tags highwayTags() {
+    static const char *highways[] = {"residential","service","footway","tertiary","secondary","primary"};
+    Tags tags{{"highway",highways[mRandom.skewed(6,2)]}};
+    if (mRandom.uniform() < 0.4) tags.emplace_back("name",name("Street "));
+    return tags;
+  }
+
+  Tags buildingTags() {
+    Tags tags{{"building",mRandom.uniform() < 0.9 ? "yes" : "house"}};
+    if (mRandom.uniform() < 0.3) tags.emplace_back("addr:housenumber",to_string(1 + mRandom.skewed(500,2)));
+    return tags;
+  }
+
+  Tags landuseTags() {
+    static const char *landuses[] = {"residential","grass","forest","industrial"};
+    return Tags{{"landuse",landuses[mRandom.below(4)]}};
+  }
+
+  const SyntheticOptions &mOptions;
+  Random mRandom;
+  vector<osmium::Location> mCenters;
+  double mRadius;
+  uint64_t mNodeId = 0;
+};
+
+class SyntheticWriter {
+  public:
+  SyntheticWriter(const string &path) : mWriter(path,header(),osmium::io::overwrite::allow) {
+    mBuffer.set_callback([&](osmium::memory::Buffer&& buffer) {
+      mWriter(std::move(buffer));
+    });
+  }
+
+  void node(const Element &e, osmium::Location location, int version, const char *timestamp) {
+    {
+      osmium::builder::NodeBuilder builder{mBuffer.buffer()};
+      setAttributes(builder,e,version,timestamp);
+      if (version > 0) builder.set_location(location);
+      addTags(builder,e.tags);
+    }
+    commit();
+  }
+
+  void way(const Element &e, const vector<uint64_t> &refs, int version, const char *timestamp) {
+    {
+      osmium::builder::WayBuilder builder{mBuffer.buffer()};
+      setAttributes(builder,e,version,timestamp);
+      {
+        osmium::builder::WayNodeListBuilder way_node_list_builder{builder};
+        for (auto ref : refs) way_node_list_builder.add_node_ref(ref);
+      }
+      addTags(builder,e.tags);
+    }
+    commit();
+  }
+
+  void relation(const Element &e, const Members &members, int version, const char *timestamp) {
+    {
+      osmium::builder::RelationBuilder builder{mBuffer.buffer()};
+      setAttributes(builder,e,version,timestamp);
+      {
+        osmium::builder::RelationMemberListBuilder relation_member_list_builder{builder};
+        for (auto const &member : members) relation_member_list_builder.add_member(member.first,member.second,"");
+      }
+      addTags(builder,e.tags);
+    }
+    commit();
+  }
+
+  void close() {
+    mBuffer.flush();
+    mWriter.close();
+  }
+
+  private:
+  static osmium::io::Header header() {
+    osmium::io::Header header;
+    header.set("generator","osmx synthetic");
+    header.set("osmosis_replication_timestamp",BASE_TIMESTAMP);
+    header.set("osmosis_replication_sequence_number","1");
+    return header;
+  }
+
+  // a negative version writes a deleted element.
+  template <typename B>
+  void setAttributes(B &builder, const Element &e, int version, const char *timestamp) {
+    builder.set_id(e.id);
+    builder.set_version(abs(version));
+    builder.set_visible(version > 0);
+    builder.set_timestamp(osmium::Timestamp{timestamp});
+    builder.set_changeset(e.id / 1000 + 1);
+    builder.set_uid(e.uid);
+    builder.set_user(("user" + to_string(e.uid)).c_str());
+  }
+
+  template <typename B>
+  void addTags(B &builder, const Tags &tags) {
+    if (tags.empty()) return;
+    osmium::builder::TagListBuilder tag_builder{builder};
+    for (auto const &tag : tags) tag_builder.add_tag(tag.first,tag.second);
+  }
+
+  void commit() {
+    mBuffer.buffer().commit();
+    mBuffer.possibly_flush();
+  }
+
+  osmium::io::Writer mWriter;
+  osmium::memory::CallbackBuffer mBuffer;
+};
+
+static void count(SyntheticStats &stats, osmium::item_type type, uint64_t id) {
+  if (type == osmium::item_type::node) {
+    stats.nodes++;
+    stats.maxNodeId = max(stats.maxNodeId,id);
+  } else if (type == osmium::item_type::way) {
+    stats.ways++;
+    stats.maxWayId = max(stats.maxWayId,id);
+  } else {
+    stats.relations++;
+    stats.maxRelationId = max(stats.maxRelationId,id);
+  }
+}
+
+// files are sorted by type, so each pass over the model writes one type.
+class DatasetPass {
+  public:
+  DatasetPass(SyntheticWriter &writer, osmium::item_type type, SyntheticStats &stats) : mWriter(writer), mType(type), mStats(stats) { }
+
+  void node(const Element &e, osmium::Location location) {
+    if (mType != osmium::item_type::node) return;
+    mWriter.node(e,location,1,BASE_TIMESTAMP);
+    count(mStats,mType,e.id);
+  }
+
+  void way(const Element &e, const vector<uint64_t> &refs) {
+    if (mType != osmium::item_type::way) return;
+    mWriter.way(e,refs,1,BASE_TIMESTAMP);
+    count(mStats,mType,e.id);
+  }
+
+  void relation(const Element &e, const Members &members) {
+    if (mType != osmium::item_type::relation) return;
+    mWriter.relation(e,members,1,BASE_TIMESTAMP);
+    count(mStats,mType,e.id);
+  }
+
+  private:
+  SyntheticWriter &mWriter;
+  osmium::item_type mType;
+  SyntheticStats &mStats;
+};
+
+// modifies changeFraction of the elements and deletes a quarter as many.
+// only points of interest and ways are deleted; routes with deleted ways are modified to leave them out.
+class ChangePass {
+  public:
+  ChangePass(SyntheticWriter &writer, osmium::item_type type, double fraction, SyntheticStats &dataset, SyntheticStats &changed) :
+    mWriter(writer), mType(type), mFraction(fraction), mDataset(dataset), mChanged(changed) { }
+
+  void node(const Element &e, osmium::Location location) {
+    count(mDataset,osmium::item_type::node,e.id);
+    if (mType != osmium::item_type::node) return;
+    double h = hashFraction(e.id,1);
+    if (h < mFraction) {
+      mWriter.node(e,osmium::Location{location.lon() + 0.0001,location.lat() + 0.0001},2,CHANGE_TIMESTAMP);
+    } else if (h < mFraction * 1.25 && !e.tags.empty()) {
+      mWriter.node(e,location,-2,CHANGE_TIMESTAMP);
+    } else {
+      return;
+    }
+    count(mChanged,mType,e.id);
+  }
+
+  void way(const Element &e, const vector<uint64_t> &refs) {
+    count(mDataset,osmium::item_type::way,e.id);
+    if (mType != osmium::item_type::way) return;
+    if (hashFraction(e.id,2) < mFraction) {
+      Element modified = e;
+      modified.tags.emplace_back("surface","asphalt");
+      mWriter.way(modified,refs,2,CHANGE_TIMESTAMP);
+    } else if (deletesWay(e.id)) {
+      mWriter.way(e,vector<uint64_t>(),-2,CHANGE_TIMESTAMP);
+    } else {
+      return;
+    }
+    count(mChanged,mType,e.id);
+  }
+
+  void relation(const Element &e, const Members &members) {
+    count(mDataset,osmium::item_type::relation,e.id);
+    if (mType != osmium::item_type::relation) return;
+    Members kept;
+    for (auto const &member : members) {
+      if (member.first != osmium::item_type::way || !deletesWay(member.second)) kept.push_back(member);
+    }
+    if (kept.size() == members.size() && hashFraction(e.id,3) >= mFraction) return;
+    Element modified = e;
+    modified.tags.emplace_back("network","synthetic");
+    mWriter.relation(modified,kept,2,CHANGE_TIMESTAMP);
+    count(mChanged,mType,e.id);
+  }
+
+  private:
+  // depends only on the id, so the relation pass knows which member ways the way pass deleted.
+  bool deletesWay(uint64_t id) const {
+    double h = hashFraction(id,2);
+    return h >= mFraction && h < mFraction * 1.25;
+  }
+
+  SyntheticWriter &mWriter;
+  osmium::item_type mType;
+  double mFraction;
+  SyntheticStats &mDataset;
+  SyntheticStats &mChanged;
+};
+
+SyntheticStats writeSynthetic(const std::string &path, const SyntheticOptions &options) {
+  SyntheticStats stats;
+  SyntheticWriter writer(path);
+  for (auto type : {osmium::item_type::node,osmium::item_type::way,osmium::item_type::relation}) {
+    Model model(options);
+    DatasetPass pass(writer,type,stats);
+    model.run(pass);
+  }
+  writer.close();
+  return stats;
+}
+
+SyntheticStats writeSyntheticChange(const std::string &path, const SyntheticOptions &options) {
+  SyntheticStats changed;
+  SyntheticStats dataset;
+  SyntheticWriter writer(path);
+  Random random(options.seed ^ 0x5eed);
+  uint64_t created_pois = 0;
+  uint64_t created_ways = 0;
+  uint64_t first_created_node = 0;
+  const int CREATED_WAY_LENGTH = 4;
+
+  for (auto type : {osmium::item_type::node,osmium::item_type::way,osmium::item_type::relation}) {
+    dataset = SyntheticStats();
+    Model model(options);
+    ChangePass pass(writer,type,options.changeFraction,dataset,changed);
+    model.run(pass);
+
+    // new points of interest, and new roads made of new nodes, after the existing ids.
+    if (type == osmium::item_type::node) {
+      created_pois = (uint64_t)(dataset.nodes * options.changeFraction / 10);
+      created_ways = (uint64_t)(dataset.ways * options.changeFraction / 10);
+      first_created_node = dataset.maxNodeId + 1;
+      uint64_t created_nodes = created_pois + created_ways * CREATED_WAY_LENGTH;
+      osmium::Location location;
+      for (uint64_t i = 0; i < created_nodes; i++) {
+        Tags tags;
+        if (i < created_pois || (i - created_pois) % CREATED_WAY_LENGTH == 0) {
+          double lon = options.bounds.left() + random.uniform() * (options.bounds.right() - options.bounds.left());
+          double lat = options.bounds.bottom() + random.uniform() * (options.bounds.top() - options.bounds.bottom());
+          location = osmium::Location{lon,lat};
+        } else {
+          location = osmium::Location{location.lon() + 0.0003,location.lat()};
+        }
+        if (i < created_pois) tags.emplace_back("amenity","cafe");
+        writer.node(Element{first_created_node + i,1,tags},location,1,CHANGE_TIMESTAMP);
+        count(changed,type,first_created_node + i);
+      }
+    } else if (type == osmium::item_type::way) {
+      for (uint64_t i = 0; i < created_ways; i++) {
+        vector<uint64_t> refs;
+        for (int j = 0; j < CREATED_WAY_LENGTH; j++) refs.push_back(first_created_node + created_pois + i * CREATED_WAY_LENGTH + j);
+        writer.way(Element{dataset.maxWayId + 1 + i,1,Tags{{"highway","service"}}},refs,1,CHANGE_TIMESTAMP);
+        count(changed,type,dataset.maxWayId + 1 + i);
+      }
+    }
+  }
+  writer.close();
+  return changed;
+}
+
+void cmdSynthetic(int argc, char* argv[]) {
+  cxxopts::Options cmdoptions("Synthetic", "Generate a synthetic OSM dataset.");
+  cmdoptions.add_options()
+    ("cmd", "Command to run", cxxopts::value<string>())
+    ("output", "Output .osm.pbf or .osm", cxxopts::value<string>())
+    ("osc", "Also write a change file", cxxopts::value<string>())
+    ("nodes", "Number of nodes", cxxopts::value<uint64_t>())
+    ("seed", "Random seed", cxxopts::value<uint64_t>())
+    ("bbox", "Bounds in minLat,minLon,maxLat,maxLon", cxxopts::value<string>())
+    ("clusters", "Number of clusters", cxxopts::value<int>())
+    ("way-length", "Mean nodes per way", cxxopts::value<double>())
+    ("id-gap", "Mean difference between consecutive node ids", cxxopts::value<double>())
+    ("relation-depth", "Nesting depth of relations", cxxopts::value<int>())
+    ("change-fraction", "Fraction of elements modified by the change file", cxxopts::value<double>())
+  ;
+  cmdoptions.parse_positional({"cmd","output"});
+  auto result = cmdoptions.parse(argc, argv);
+
+  if (result.count("output") == 0) {
+    cout << "Usage: osmx synthetic OUTPUT_FILE [OPTIONS]" << endl;
+    cout << "Writes a deterministic synthetic dataset, and optionally a change file for it." << endl << endl;
+    cout << "EXAMPLE:" << endl;
+    cout << " osmx synthetic synthetic.osm.pbf --nodes 100000000 --osc synthetic.osc" << endl << endl;
+    cout << "OPTIONS:" << endl;
+    cout << " --osc FILE: also write an .osc that modifies, deletes and creates elements." << endl;
+    cout << " --nodes N: number of nodes, default 1000000." << endl;
+    cout << " --seed N: random seed, default 0." << endl;
+    cout << " --bbox MIN_LAT,MIN_LON,MAX_LAT,MAX_LON: bounds of the dataset, default New York City." << endl;
+    cout << " --clusters N: nodes are placed around N centers of decreasing density, default 100." << endl;
+    cout << " --way-length N: mean number of nodes of a road, default 10." << endl;
+    cout << " --id-gap N: mean difference between consecutive node ids, default 1.2." << endl;
+    cout << " --relation-depth N: relations of ways are grouped into relations up to this depth, default 3." << endl;
+    cout << " --change-fraction F: fraction of elements modified by the change file, default 0.01." << endl;
+    exit(1);
+  }
+
+  SyntheticOptions options;
+  if (result.count("nodes")) options.nodes = result["nodes"].as<uint64_t>();
+  if (result.count("seed")) options.seed = result["seed"].as<uint64_t>();
+  if (result.count("bbox")) {
+    double min_lat, min_lon, max_lat, max_lon;
+    if (sscanf(result["bbox"].as<string>().c_str(),"%lf,%lf,%lf,%lf",&min_lat,&min_lon,&max_lat,&max_lon) != 4) {
+      cout << "Invalid bbox." << endl;
+      exit(1);
+    }
+    options.bounds = osmium::Box{min_lon,min_lat,max_lon,max_lat};
+  }
+  if (result.count("clusters")) options.clusters = result["clusters"].as<int>();
+  if (result.count("way-length")) options.wayLength = result["way-length"].as<double>();
+  if (result.count("id-gap")) options.idGap = result["id-gap"].as<double>();
+  if (result.count("relation-depth")) options.relationDepth = result["relation-depth"].as<int>();
+  if (result.count("change-fraction")) options.changeFraction = result["change-fraction"].as<double>();
+
+  {
+    Timer timer("dataset");
+    auto stats = writeSynthetic(result["output"].as<string>(),options);
+    cout << "Nodes: " << stats.nodes << " Ways: " << stats.ways << " Relations: " << stats.relations << endl;
+  }
+  if (result.count("osc")) {
+    Timer timer("change");
+    auto stats = writeSyntheticChange(result["osc"].as<string>(),options);
+    cout << "Nodes: " << stats.nodes << " Ways: " << stats.ways << " Relations: " << stats.relations << endl;
+  }
+}
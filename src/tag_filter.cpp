@@ -0,0 +1,70 @@
+#include <cstring>
+#include "osmx/tag_filter.h"
+
+using namespace std;
+
+namespace osmx {
+
+bool TagFilter::add(const string &expression) {
+  Expression e{true,true,true,"",true,""};
+  string rest = expression;
+  auto slash = rest.find('/');
+  if (slash != string::npos) {
+    string types = rest.substr(0,slash);
+    if (types.empty()) return false;
+    e.node = e.way = e.relation = false;
+    for (char c : types) {
+      if (c == 'n') e.node = true;
+      else if (c == 'w') e.way = true;
+      else if (c == 'r') e.relation = true;
+      else return false;
+    }
+    rest = rest.substr(slash + 1);
+  }
+  auto equals = rest.find('=');
+  if (equals != string::npos) {
+    e.anyValue = false;
+    e.value = rest.substr(equals + 1);
+    rest = rest.substr(0,equals);
+  }
+  if (rest.empty()) return false;
+  e.key = rest;
+  mExpressions.push_back(e);
+  return true;
+}
+
+bool TagFilter::filters(osmium::item_type type) const {
+  for (auto const &e : mExpressions) {
+    if (type == osmium::item_type::node && e.node) return true;
+    if (type == osmium::item_type::way && e.way) return true;
+    if (type == osmium::item_type::relation && e.relation) return true;
+  }
+  return false;
+}
+
+bool TagFilter::matches(osmium::item_type type, const char *key, const char *value) const {
+  for (auto const &e : mExpressions) {
+    if (type == osmium::item_type::node && !e.node) continue;
+    if (type == osmium::item_type::way && !e.way) continue;
+    if (type == osmium::item_type::relation && !e.relation) continue;
+    if (strcmp(key,e.key.c_str())) continue;
+    if (e.anyValue || !strcmp(value,e.value.c_str())) return true;
+  }
+  return false;
+}
+
+bool TagFilter::lookup(db::TagIndex &index, osmium::item_type type, const Roaring64Map &within, Roaring64Map &ids) const {
+  if (!index.present()) return false;
+  vector<const Expression *> expressions;
+  for (auto const &e : mExpressions) {
+    if (type == osmium::item_type::node && !e.node) continue;
+    if (type == osmium::item_type::way && !e.way) continue;
+    if (type == osmium::item_type::relation && !e.relation) continue;
+    if (!index.indexes(e.key)) return false;
+    expressions.push_back(&e);
+  }
+  for (auto e : expressions) index.get(type,e->key,e->anyValue,e->value,within,ids);
+  return true;
+}
+
+}
@@ -9,24 +9,37 @@
 #include "osmium/util/progress_bar.hpp"
 #include "s2/s2latlng.h"
 #include "s2/s2cell_union.h"
+#include "s2/s2region_coverer.h"
 #include "osmx/storage.h"
+#include "osmx/metrics.h"
+#include "osmx/augmented_diff.h"
+#include "osmx/region.h"
 
 using namespace std;
 using namespace osmx;
 
 class DataUpdate : public osmium::handler::Handler {
   public:
-  DataUpdate(MDB_txn *txn) : 
+  DataUpdate(MDB_txn *txn, bool packNodes) : 
   mTxn(txn), 
+  mPackNodes(packNodes),
+  mStrings(txn),
   mLocations(txn), 
   mNodes(txn,"nodes"), 
   mWays(txn,"ways"), 
   mRelations(txn,"relations"),
   mCellNode(txn,"cell_node"),
+  mCellCounts(txn),
   mNodeWay(txn,"node_way"),
   mNodeRelation(txn,"node_relation"),
   mWayRelation(txn,"way_relation"),
-  mRelationRelation(txn, "relation_relation")  {
+  mRelationRelation(txn, "relation_relation"),
+  mTagIndex(txn)  {
+  }
+
+  // writes the buffered changes to the tag index.
+  void flush() {
+    mTagIndex.flush();
   }
 
   // update location, node, cell_location tables
@@ -37,26 +50,35 @@ class DataUpdate : public osmium::handler::Handler {
     uint64_t prev_cell;
     if (prev_location.is_defined()) prev_cell = S2CellId(S2LatLng::FromDegrees(prev_location.coords.lat(),prev_location.coords.lon())).parent(CELL_INDEX_LEVEL).id();
 
+    if (mTagIndex.present()) {
+      auto maybe_reader = mNodes.tryGet(id);
+      KJ_IF_MAYBE(reader, maybe_reader) {
+        mTagIndex.remove(mStrings,osmium::item_type::node,reader->getRoot<Node>(),id);
+      }
+    }
+
     if (!node.visible()) {
       mLocations.del(id);
       mNodes.del(id);
       mCellNode.del(prev_cell,id);
+      if (prev_location.is_defined()) mCellCounts.add(S2CellId(prev_cell),-1);
       return;
     } else {
       mLocations.put(id,new_location);
       if (node.tags().size() > 0) {
         ::capnp::MallocMessageBuilder message;
         Node::Builder nodeMsg = message.initRoot<Node>();
-        setTags<Node::Builder>(node.tags(),nodeMsg);
+        db::setTags<Node::Builder>(node.tags(),nodeMsg,mStrings);
         auto metadata = nodeMsg.initMetadata();
         metadata.setVersion(node.version());
         metadata.setTimestamp(node.timestamp().seconds_since_epoch());
         metadata.setChangeset(node.changeset());
         metadata.setUid(node.uid());
-        metadata.setUser(node.user());
+        db::setUser(metadata,node.user(),mStrings);
         kj::VectorOutputStream output;
         capnp::writeMessage(output,message);
         mNodes.put(id,output);
+        mTagIndex.add(osmium::item_type::node,node.tags(),id);
       } else {
         mNodes.del(id); 
       }
@@ -65,12 +87,15 @@ class DataUpdate : public osmium::handler::Handler {
     uint64_t new_cell = S2CellId(S2LatLng::FromDegrees(new_location.coords.lat(),new_location.coords.lon())).parent(CELL_INDEX_LEVEL).id();
     if (!prev_location.is_defined()) {
       mCellNode.put(new_cell,id);
+      mCellCounts.add(S2CellId(new_cell),1);
       return;
     }
 
     if (prev_cell != new_cell) {
       mCellNode.del(prev_cell,id);
       mCellNode.put(new_cell,id);
+      mCellCounts.add(S2CellId(prev_cell),-1);
+      mCellCounts.add(S2CellId(new_cell),1);
     }
   }
 
@@ -81,12 +106,13 @@ class DataUpdate : public osmium::handler::Handler {
     set<uint64_t> prev_nodes;
     set<uint64_t> new_nodes;
 
-    if (mWays.exists(id)) {
-      auto reader = mWays.getReader(id);
-      Way::Reader way = reader.getRoot<Way>();
-      for (auto const &node_id : way.getNodes()) {
+    auto maybe_reader = mWays.tryGet(id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      Way::Reader way = reader->getRoot<Way>();
+      db::forEachNode(way,[&](uint64_t node_id) {
         prev_nodes.insert(node_id);
-      }
+      });
+      if (mTagIndex.present()) mTagIndex.remove(mStrings,osmium::item_type::way,way,id);
     }
 
     if (!way.visible()) {
@@ -95,22 +121,21 @@ class DataUpdate : public osmium::handler::Handler {
       auto const &nodes = way.nodes();
       ::capnp::MallocMessageBuilder message;
       Way::Builder wayMsg = message.initRoot<Way>();
-      wayMsg.initNodes(nodes.size());
-      int i = 0;
-      for (int i = 0; i < nodes.size(); i++) {
-        wayMsg.getNodes().set(i,nodes[i].ref());
-        new_nodes.insert(nodes[i].ref());
+      db::setNodes(wayMsg,nodes,mPackNodes);
+      for (auto const &node_ref : nodes) {
+        new_nodes.insert(node_ref.ref());
       }
-      setTags<Way::Builder>(way.tags(),wayMsg);
+      db::setTags<Way::Builder>(way.tags(),wayMsg,mStrings);
       auto metadata = wayMsg.initMetadata();
       metadata.setVersion(way.version());
       metadata.setTimestamp(way.timestamp().seconds_since_epoch());
       metadata.setChangeset(way.changeset());
       metadata.setUid(way.uid());
-      metadata.setUser(way.user());
+      db::setUser(metadata,way.user(),mStrings);
       kj::VectorOutputStream output;
       capnp::writeMessage(output,message);
       mWays.put(id,output);
+      mTagIndex.add(osmium::item_type::way,way.tags(),id);
     }
 
     if (!way.visible()) {
@@ -136,9 +161,9 @@ class DataUpdate : public osmium::handler::Handler {
     set<uint64_t> new_ways;
     set<uint64_t> new_relations;
 
-    if (mRelations.exists(id)) {
-      auto reader = mRelations.getReader(id);
-      Relation::Reader relation = reader.getRoot<Relation>();
+    auto maybe_reader = mRelations.tryGet(id);
+    KJ_IF_MAYBE(reader, maybe_reader) {
+      Relation::Reader relation = reader->getRoot<Relation>();
       for (auto const &member : relation.getMembers()) {
         if (member.getType() == RelationMember::Type::NODE) {
           prev_nodes.insert(member.getRef());
@@ -148,6 +173,7 @@ class DataUpdate : public osmium::handler::Handler {
           prev_relations.insert(member.getRef());
         }
       }
+      if (mTagIndex.present()) mTagIndex.remove(mStrings,osmium::item_type::relation,relation,id);
     }
 
     if (!relation.visible()) {
@@ -155,7 +181,7 @@ class DataUpdate : public osmium::handler::Handler {
     } else {
       ::capnp::MallocMessageBuilder message;
       Relation::Builder relationMsg = message.initRoot<Relation>();
-      setTags<Relation::Builder>(relation.tags(),relationMsg);
+      db::setTags<Relation::Builder>(relation.tags(),relationMsg,mStrings);
       auto members = relationMsg.initMembers(relation.members().size());
       int i = 0;
       for (auto const &member : relation.members()) {
@@ -180,10 +206,11 @@ class DataUpdate : public osmium::handler::Handler {
       metadata.setTimestamp(relation.timestamp().seconds_since_epoch());
       metadata.setChangeset(relation.changeset());
       metadata.setUid(relation.uid());
-      metadata.setUser(relation.user());
+      db::setUser(metadata,relation.user(),mStrings);
       kj::VectorOutputStream output;
       capnp::writeMessage(output,message);
       mRelations.put(relation.id(),output);
+      mTagIndex.add(osmium::item_type::relation,relation.tags(),id);
     }
 
     if (!relation.visible()) {
@@ -214,27 +241,104 @@ class DataUpdate : public osmium::handler::Handler {
 
   private:
   MDB_txn *mTxn;
-  db::Locations mLocations;
-  db::Elements mNodes;
-  db::Elements mWays;
-  db::Elements mRelations;
+  bool mPackNodes;
+  db::StringTable mStrings;
+  // .osc files are sorted by type and id, so each lookup is usually near the previous one.
+  db::LocationCursor mLocations;
+  db::ElementCursor mNodes;
+  db::ElementCursor mWays;
+  db::ElementCursor mRelations;
   db::Index mNodeWay;
   db::Index mNodeRelation;
   db::Index mWayRelation;
   db::Index mRelationRelation;
   db::Index mCellNode;
+  db::CellCounts mCellCounts;
+  db::TagIndex mTagIndex;
+};
+
+// collects the ids in the change file for the changelog table.
+class ChangeRecorder : public osmium::handler::Handler {
+  public:
+  void node(const osmium::Node &node) {
+    mChanges.nodes.add((uint64_t)node.id());
+  }
+
+  void way(const osmium::Way &way) {
+    mChanges.ways.add((uint64_t)way.id());
+  }
+
+  void relation(const osmium::Relation &relation) {
+    mChanges.relations.add((uint64_t)relation.id());
+  }
+
+  db::ChangeSet mChanges;
+};
+
+// keeps a regional shard to its region, passing on only the changes to objects that belong in it:
+// objects already in the file, new nodes in the covering, and new ways and relations with a node or member in the file.
+// changes arrive as nodes, then ways, then relations, so new nodes are in the file before the ways that use them.
+// like any self-updating extract, a way that grows into the region can lack the nodes outside it.
+// recorder is null when the file has no changelog.
+class ShardFilter : public osmium::handler::Handler {
+  public:
+  ShardFilter(MDB_txn *txn, const S2CellUnion &covering, DataUpdate &update, ChangeRecorder *recorder) : mCovering(covering), mUpdate(update), mRecorder(recorder), mLocations(txn), mWays(txn,"ways"), mRelations(txn,"relations") { }
+
+  void node(const osmium::Node &node) {
+    bool inside = node.visible() && node.location().valid() && mCovering.Contains(S2CellId(S2LatLng::FromDegrees(node.location().lat(),node.location().lon())));
+    if (!inside && !mLocations.exists(node.id())) return;
+    mUpdate.node(node);
+    if (mRecorder) mRecorder->node(node);
+  }
+
+  void way(const osmium::Way &way) {
+    bool keep = mWays.exists(way.id());
+    for (auto const &node_ref : way.nodes()) {
+      if (keep) break;
+      keep = mLocations.exists(node_ref.ref());
+    }
+    if (!keep) return;
+    mUpdate.way(way);
+    if (mRecorder) mRecorder->way(way);
+  }
+
+  void relation(const osmium::Relation &relation) {
+    bool keep = mRelations.exists(relation.id());
+    for (auto const &member : relation.members()) {
+      if (keep) break;
+      if (member.type() == osmium::item_type::node) keep = mLocations.exists(member.ref());
+      else if (member.type() == osmium::item_type::way) keep = mWays.exists(member.ref());
+      else keep = mRelations.exists(member.ref());
+    }
+    if (!keep) return;
+    mUpdate.relation(relation);
+    if (mRecorder) mRecorder->relation(relation);
+  }
+
+  private:
+  const S2CellUnion &mCovering;
+  DataUpdate &mUpdate;
+  ChangeRecorder *mRecorder;
+  db::LocationCursor mLocations;
+  db::ElementCursor mWays;
+  db::ElementCursor mRelations;
 };
 
 void cmdUpdate(int argc, char* argv[]) {
   cxxopts::Options cmdoptions("Update", "Update an .osmx file with a .osc diff.");
   cmdoptions.add_options()
     ("v,verbose", "Verbose output")
+    ("quiet", "Don't print progress")
     ("commit", "Commit the update")
+    ("changelog", "Record the changed ids under the sequence number")
+    ("augmented-diff", "Write an augmented diff of the .osc to this file", cxxopts::value<string>())
+    ("region", "Only apply changes to objects in this region, for a shard", cxxopts::value<string>())
     ("cmd", "Command to run", cxxopts::value<string>())
     ("osmx", ".osmx to update", cxxopts::value<string>())
     ("osc", ".osc to apply", cxxopts::value<string>())
     ("seqnum", "The sequence number of the .osc", cxxopts::value<string>())
     ("timestamp", "The timestamp of the .osc", cxxopts::value<string>())
+    ("metrics", "Write metrics to this file", cxxopts::value<string>())
   ;
 
   cmdoptions.parse_positional({"cmd","osmx","osc","seqnum","timestamp"});
@@ -248,32 +352,70 @@ void cmdUpdate(int argc, char* argv[]) {
     cout << " osmx update planet.osmx 123456.osc 123456 2019-09-05T00:00:00Z --commit" << endl << endl;
     cout << "OPTIONS:" << endl;
     cout << " --v,--verbose: verbose output." << endl;
+    cout << " --quiet: don't print the result, only errors." << endl;
     cout << " --commit: Actually commit the transaction; otherwise runs the update and rolls back." << endl;
+    cout << " --changelog: record the ids changed by SEQNUM, for osmx changes. Once the changelog exists, every update records to it." << endl;
+    cout << " --augmented-diff FILE: write an augmented diff of OSC_FILE, as osmx augmented-diff does before the update." << endl;
+    cout << " --region FILE: for a regional shard, only apply changes to objects in the file or in the region. Shards have separate files, so their updates can run in parallel." << endl;
+    cout << " --metrics FILE: write phase timings and table sizes as JSON, or Prometheus text if FILE ends in .prom; - for stdout." << endl;
     exit(1);
   }
 
   string osmx = result["osmx"].as<string>();
   string osc = result["osc"].as<string>();
   bool verbose = result.count("verbose") > 0;
+  if (result.count("quiet")) quiet() = true;
   auto startTime = std::chrono::high_resolution_clock::now();
+  Metrics metrics("update");
 
-  MDB_env* env = db::createEnv(osmx,true);
-  MDB_txn* txn;
-  CHECK(mdb_txn_begin(env, NULL, 0, &txn));
+  db::Env env(osmx,true);
+  db::Txn txn(env,true);
 
   string old_seqnum = "UNKNOWN";
   auto new_seqnum = result["seqnum"].as<string>();
   auto new_timestamp = result["timestamp"].as<string>();
   db::Metadata metadata(txn);
-  if (verbose) cout << "Timestamp: " << metadata.get("osmosis_replication_timestamp") << endl;
+  if (verbose) progress() << "Timestamp: " << metadata.get("osmosis_replication_timestamp") << endl;
   old_seqnum = metadata.get("osmosis_replication_sequence_number");
 
-  if (verbose) cout << "Starting update from " << old_seqnum << " to " << new_seqnum << endl;
+  if (verbose) progress() << "Starting update from " << old_seqnum << " to " << new_seqnum << endl;
   const osmium::io::File input_file{osc};
 
-  osmium::io::Reader reader{input_file, osmium::osm_entity_bits::object};
-  DataUpdate data_update(txn);
-  osmium::apply(reader, data_update);
+  // the old versions are read in the same txn, before the update changes them.
+  if (result.count("augmented-diff")) {
+    Phase phase(metrics,"augmented_diff");
+    writeAugmentedDiff(txn,osc,result["augmented-diff"].as<string>());
+  }
+
+  {
+    Phase phase(metrics,"apply");
+    osmium::io::Reader reader{input_file, osmium::osm_entity_bits::object};
+    // keep the way node encoding chosen at expand time.
+    DataUpdate data_update(txn,metadata.get("way_nodes") == "packed");
+    db::Changelog changelog(txn,result.count("changelog") > 0);
+    ChangeRecorder recorder;
+    if (result.count("region")) {
+      auto region = Region::FromFile(result["region"].as<string>());
+      if (!region) {
+        cout << "Unknown region file type: " << result["region"].as<string>() << endl;
+        exit(1);
+      }
+      S2RegionCoverer::Options options;
+      options.set_max_cells(1024);
+      options.set_max_level(CELL_INDEX_LEVEL);
+      S2RegionCoverer coverer(options);
+      S2CellUnion covering = region->GetCovering(coverer);
+      ShardFilter shard_filter(txn,covering,data_update,changelog.present() ? &recorder : nullptr);
+      osmium::apply(reader, shard_filter);
+    } else if (changelog.present()) {
+      osmium::apply(reader, data_update, recorder);
+    } else {
+      osmium::apply(reader, data_update);
+    }
+    if (changelog.present()) changelog.put(stoull(new_seqnum),recorder.mChanges);
+    data_update.flush();
+  }
+  if (result.count("metrics")) metrics.lmdb(env,txn);
   
   auto duration = (std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::high_resolution_clock::now() - startTime ).count()) / 1000.0;
 
@@ -282,14 +424,15 @@ void cmdUpdate(int argc, char* argv[]) {
       metadata.put("osmosis_replication_sequence_number",new_seqnum);
       metadata.put("osmosis_replication_timestamp",new_timestamp);
     }
-    CHECK(mdb_txn_commit(txn));
-    cout << "Committed: ";
+    Phase phase(metrics,"commit");
+    txn.commit();
+    progress() << "Committed: ";
   } else {
-    mdb_txn_abort(txn);
-    cout << "Aborted: ";
+    txn.abort();
+    progress() << "Aborted: ";
   }
-  cout << old_seqnum << " -> " << new_seqnum << " in " << duration << " seconds." << endl;
-  mdb_env_sync(env,true);
-  mdb_env_close(env);
+  progress() << old_seqnum << " -> " << new_seqnum << " in " << duration << " seconds." << endl;
+  env.sync();
+  if (result.count("metrics")) metrics.write(result["metrics"].as<string>());
 }
 
@@ -0,0 +1,131 @@
+#include "catch2/catch_test_macros.hpp"
+#include "s2/s2region_coverer.h"
+#include "capnp/message.h"
+#include "capnp/serialize.h"
+#include "osmx/storage.h"
+#include "osmx/region.h"
+#include "osmx/changes.h"
+
+using namespace std;
+using namespace osmx;
+
+TEST_CASE("changelog") {
+    MDB_env *env = db::createMemoryEnv();
+    MDB_txn *txn;
+    REQUIRE(mdb_txn_begin(env,NULL,0,&txn) == 0);
+
+    SECTION("absent without create") {
+        db::Changelog changelog(txn);
+        REQUIRE(!changelog.present());
+        db::ChangeSet changes;
+        REQUIRE(changelog.get(0,10,changes) == 0);
+    }
+
+    SECTION("round trip") {
+        db::Changelog changelog(txn,true);
+        REQUIRE(changelog.present());
+        db::ChangeSet first;
+        first.nodes.add(1);
+        first.nodes.add(5000000000);
+        first.ways.add(2);
+        changelog.put(101,first);
+        db::ChangeSet second;
+        second.nodes.add(3);
+        second.relations.add(4);
+        changelog.put(102,second);
+        db::ChangeSet third;
+        third.ways.add(6);
+        changelog.put(103,third);
+
+        db::ChangeSet changes;
+        REQUIRE(changelog.get(100,102,changes) == 2);
+        REQUIRE(changes.nodes.cardinality() == 3);
+        REQUIRE(changes.nodes.contains((uint64_t)5000000000));
+        REQUIRE(changes.ways.cardinality() == 1);
+        REQUIRE(changes.relations.contains((uint64_t)4));
+
+        db::ChangeSet later;
+        REQUIRE(changelog.get(102,200,later) == 1);
+        REQUIRE(later.ways.contains((uint64_t)6));
+        REQUIRE(later.nodes.isEmpty());
+    }
+
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+}
+
+static void putWay(db::Elements &ways, uint64_t id, const vector<uint64_t> &node_ids) {
+    capnp::MallocMessageBuilder message;
+    Way::Builder wayMsg = message.initRoot<Way>();
+    auto nodes = wayMsg.initNodes(node_ids.size());
+    for (size_t i = 0; i < node_ids.size(); i++) nodes.set(i,node_ids[i]);
+    kj::VectorOutputStream output;
+    capnp::writeMessage(output,message);
+    ways.put(id,output);
+}
+
+TEST_CASE("region selection of changes") {
+    MDB_env *env = db::createMemoryEnv();
+    MDB_txn *txn;
+    REQUIRE(mdb_txn_begin(env,NULL,0,&txn) == 0);
+
+    // nodes 1 and 2 are in the region, 3 and 4 are not.
+    db::Locations locations(txn);
+    locations.put(1,db::Location(osmium::Location(0.5,0.5),1));
+    locations.put(2,db::Location(osmium::Location(0.6,0.6),1));
+    locations.put(3,db::Location(osmium::Location(10.0,10.0),1));
+    locations.put(4,db::Location(osmium::Location(11.0,11.0),1));
+
+    // way 10 crosses the boundary, way 11 is outside.
+    db::Elements ways(txn,"ways");
+    putWay(ways,10,{2,3});
+    putWay(ways,11,{3,4});
+    db::Index node_way(txn,"node_way");
+    node_way.put(2,10);
+    node_way.put(3,10);
+    node_way.put(3,11);
+    node_way.put(4,11);
+
+    Region region("0,0,1,1","bbox");
+    S2RegionCoverer::Options options;
+    options.set_max_cells(1024);
+    options.set_max_level(CELL_INDEX_LEVEL);
+    S2RegionCoverer coverer(options);
+    S2CellUnion covering = region.GetCovering(coverer);
+
+    SECTION("nodes") {
+        db::ChangeSet changes;
+        changes.nodes.add(1);
+        changes.nodes.add(4);
+        changes.nodes.add(99);
+        db::ChangeSet selected;
+        selectChanges(txn,covering,changes,selected);
+        REQUIRE(selected.nodes.contains((uint64_t)1));
+        REQUIRE(!selected.nodes.contains((uint64_t)4));
+        REQUIRE(!selected.nodes.contains((uint64_t)99));
+    }
+
+    SECTION("a node outside used by a way in the region") {
+        db::ChangeSet changes;
+        changes.nodes.add(3);
+        db::ChangeSet selected;
+        selectChanges(txn,covering,changes,selected);
+        REQUIRE(selected.nodes.contains((uint64_t)3));
+    }
+
+    SECTION("ways and their nodes") {
+        db::ChangeSet changes;
+        changes.ways.add(10);
+        changes.ways.add(11);
+        db::ChangeSet selected;
+        selectChanges(txn,covering,changes,selected);
+        REQUIRE(selected.ways.contains((uint64_t)10));
+        REQUIRE(!selected.ways.contains((uint64_t)11));
+        REQUIRE(selected.nodes.contains((uint64_t)2));
+        REQUIRE(selected.nodes.contains((uint64_t)3));
+        REQUIRE(!selected.nodes.contains((uint64_t)4));
+    }
+
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+}
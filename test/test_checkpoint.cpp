@@ -0,0 +1,50 @@
+#include "catch2/catch_test_macros.hpp"
+#include "osmx/checkpoint.h"
+
+using namespace std;
+
+TEST_CASE("expand checkpoint") {
+    SECTION("empty") {
+        Checkpoint checkpoint("");
+        REQUIRE(checkpoint.empty());
+        REQUIRE(!checkpoint.skip('n',1));
+        REQUIRE(checkpoint.runs("node_way") == 0);
+    }
+
+    SECTION("round trip") {
+        Checkpoint checkpoint;
+        checkpoint.set('w',1234);
+        checkpoint.setRuns("node_way",3);
+        checkpoint.setRuns("way_relation",12);
+        checkpoint.finish("cell_node");
+        checkpoint.finish("cluster_nodes");
+
+        Checkpoint restored(checkpoint.str());
+        REQUIRE(restored.str() == checkpoint.str());
+        REQUIRE(!restored.empty());
+        REQUIRE(restored.runs("node_way") == 3);
+        REQUIRE(restored.runs("way_relation") == 12);
+        REQUIRE(restored.runs("node_relation") == 0);
+        REQUIRE(restored.finished("cell_node"));
+        REQUIRE(restored.finished("cluster_nodes"));
+        REQUIRE(!restored.finished("node_way"));
+    }
+
+    SECTION("skip") {
+        Checkpoint checkpoint("w 1234");
+        REQUIRE(checkpoint.skip('n',99999));
+        REQUIRE(checkpoint.skip('w',1234));
+        REQUIRE(!checkpoint.skip('w',1235));
+        REQUIRE(!checkpoint.skip('r',1));
+        REQUIRE(!checkpoint.elementsDone());
+        REQUIRE(Checkpoint("i 0").elementsDone());
+    }
+
+    SECTION("committed") {
+        Checkpoint checkpoint("w 1234");
+        REQUIRE(checkpoint.committed('n') == UINT64_MAX);
+        REQUIRE(checkpoint.committed('w') == 1234);
+        REQUIRE(checkpoint.committed('r') == 0);
+        REQUIRE(Checkpoint("").committed('n') == 0);
+    }
+}
@@ -200,3 +200,35 @@ END
 
     }
 }
+
+TEST_CASE("batch ranges") {
+    SECTION("nested cells") {
+        S2CellId face = S2CellId::FromFace(0);
+        S2CellId child = face.child(1);
+        vector<S2CellUnion> coverings{S2CellUnion({face}),S2CellUnion({child})};
+        auto ranges = batchRanges(coverings);
+        REQUIRE(ranges.size() == 3);
+        REQUIRE(ranges[0].start == face.range_min().id());
+        REQUIRE(ranges[0].end == child.range_min().id());
+        REQUIRE(ranges[0].regions == vector<size_t>{0});
+        REQUIRE(ranges[1].start == child.range_min().id());
+        REQUIRE(ranges[1].end == child.range_max().id() + 1);
+        REQUIRE(ranges[1].regions == vector<size_t>{0,1});
+        REQUIRE(ranges[2].start == child.range_max().id() + 1);
+        REQUIRE(ranges[2].end == face.range_max().id() + 1);
+        REQUIRE(ranges[2].regions == vector<size_t>{0});
+    }
+
+    SECTION("disjoint cells") {
+        vector<S2CellUnion> coverings{S2CellUnion({S2CellId::FromFace(2)}),S2CellUnion({S2CellId::FromFace(1)})};
+        auto ranges = batchRanges(coverings);
+        REQUIRE(ranges.size() == 2);
+        REQUIRE(ranges[0].regions == vector<size_t>{1});
+        REQUIRE(ranges[1].regions == vector<size_t>{0});
+        REQUIRE(ranges[0].end < ranges[1].start);
+    }
+
+    SECTION("no regions") {
+        REQUIRE(batchRanges(vector<S2CellUnion>()).empty());
+    }
+}
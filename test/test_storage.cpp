@@ -0,0 +1,170 @@
+#include "catch2/catch_test_macros.hpp"
+#include "osmium/builder/osm_object_builder.hpp"
+#include "s2/s2latlng.h"
+#include "capnp/message.h"
+#include "capnp/serialize.h"
+#include "osmx/storage.h"
+
+using namespace std;
+using namespace osmx;
+
+// writes the node ids with setNodes and reads them back with forEachNode.
+static vector<uint64_t> roundTrip(const vector<uint64_t> &ids, bool packed) {
+    osmium::memory::Buffer buffer{1024,osmium::memory::Buffer::auto_grow::yes};
+    {
+        osmium::builder::WayBuilder builder{buffer};
+        osmium::builder::WayNodeListBuilder way_node_list_builder{builder};
+        for (auto id : ids) way_node_list_builder.add_node_ref(id);
+    }
+    buffer.commit();
+    auto const &way = buffer.get<osmium::Way>(0);
+
+    capnp::MallocMessageBuilder message;
+    Way::Builder wayMsg = message.initRoot<Way>();
+    db::setNodes(wayMsg,way.nodes(),packed);
+    REQUIRE(wayMsg.asReader().hasPackedNodes() == packed);
+
+    vector<uint64_t> result;
+    db::forEachNode(wayMsg.asReader(),[&](uint64_t node_id) {
+        result.push_back(node_id);
+    });
+    return result;
+}
+
+TEST_CASE("zigzag varint node ids") {
+    SECTION("increasing ids") {
+        vector<uint64_t> ids{1,2,3,130,20000,20001};
+        REQUIRE(roundTrip(ids,true) == ids);
+    }
+
+    SECTION("decreasing ids, with negative deltas") {
+        vector<uint64_t> ids{5000000000,4999999999,100,1};
+        REQUIRE(roundTrip(ids,true) == ids);
+    }
+
+    SECTION("closed way") {
+        vector<uint64_t> ids{11000000000,11000000005,11000000003,11000000000};
+        REQUIRE(roundTrip(ids,true) == ids);
+    }
+
+    SECTION("deltas of one, two and many bytes") {
+        vector<uint64_t> ids{63,64,8255,8256,(1ULL << 40),1};
+        REQUIRE(roundTrip(ids,true) == ids);
+    }
+
+    SECTION("unpacked") {
+        vector<uint64_t> ids{3,2,1};
+        REQUIRE(roundTrip(ids,false) == ids);
+    }
+}
+
+TEST_CASE("truncated packed node ids") {
+    capnp::MallocMessageBuilder message;
+    Way::Builder wayMsg = message.initRoot<Way>();
+    // node 1, then a varint whose continuation bit runs past the end.
+    kj::byte bytes[] = {0x02,0x80,0x80};
+    wayMsg.setPackedNodes(kj::arrayPtr(bytes,sizeof(bytes)));
+
+    vector<uint64_t> result;
+    db::forEachNode(wayMsg.asReader(),[&](uint64_t node_id) {
+        result.push_back(node_id);
+    });
+    REQUIRE(result == vector<uint64_t>{1});
+}
+
+TEST_CASE("packed elements") {
+    MDB_env *env = db::createMemoryEnv();
+    MDB_txn *txn;
+    REQUIRE(mdb_txn_begin(env,NULL,0,&txn) == 0);
+    db::Metadata(txn).put("element_encoding","packed");
+    db::Elements nodes(txn,"nodes");
+
+    SECTION("round trip") {
+        capnp::MallocMessageBuilder message;
+        Node::Builder nodeMsg = message.initRoot<Node>();
+        auto tags = nodeMsg.initTags(2);
+        tags.set(0,"amenity");
+        tags.set(1,"cafe");
+        nodeMsg.initMetadata().setVersion(3);
+        kj::VectorOutputStream output;
+        capnp::writeMessage(output,message);
+        nodes.put(7,output);
+
+        auto node = nodes.getReader(7).getRoot<Node>();
+        REQUIRE(node.getTags().size() == 2);
+        REQUIRE(node.getTags()[1] == "cafe");
+        REQUIRE(node.getMetadata().getVersion() == 3);
+        REQUIRE(nodes.tryGet(8) == nullptr);
+    }
+
+    SECTION("several segments") {
+        // small fixed segments, so the message is split.
+        capnp::MallocMessageBuilder message(8,capnp::AllocationStrategy::FIXED_SIZE);
+        Node::Builder nodeMsg = message.initRoot<Node>();
+        auto tags = nodeMsg.initTags(100);
+        for (int i = 0; i < 100; i++) tags.set(i,("value" + to_string(i)).c_str());
+        REQUIRE(message.getSegmentsForOutput().size() > 1);
+        kj::VectorOutputStream output;
+        capnp::writeMessage(output,message);
+        nodes.put(9,output);
+
+        auto node = nodes.getReader(9).getRoot<Node>();
+        REQUIRE(node.getTags().size() == 100);
+        REQUIRE(node.getTags()[99] == "value99");
+    }
+
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+}
+
+TEST_CASE("cluster positions") {
+    S2CellId cell = S2CellId(S2LatLng::FromDegrees(40.7,-74.0)).parent(CELL_INDEX_LEVEL);
+    S2CellId far = S2CellId(S2LatLng::FromDegrees(-33.9,151.2)).parent(CELL_INDEX_LEVEL);
+
+    SECTION("without a cell, the id") {
+        REQUIRE(db::clusterPosition(S2CellId(),42) == 42);
+    }
+
+    SECTION("the id in the lower 35 bits") {
+        uint64_t id = db::CLUSTER_MAX_ID - 1;
+        REQUIRE((db::clusterPosition(cell,id) & (db::CLUSTER_MAX_ID - 1)) == id);
+        REQUIRE((db::clusterPosition(cell,1) & (db::CLUSTER_MAX_ID - 1)) == 1);
+    }
+
+    SECTION("cells of the same level 13 cell share the upper bits") {
+        S2CellId sibling = cell.parent(13).child_begin(CELL_INDEX_LEVEL);
+        REQUIRE((db::clusterPosition(cell,5) >> 35) == (db::clusterPosition(sibling,6) >> 35));
+        REQUIRE(db::clusterPosition(cell,5) < db::clusterPosition(sibling,6));
+    }
+
+    SECTION("ordered by cell before id") {
+        bool cellFirst = cell < far;
+        REQUIRE((db::clusterPosition(cell,1000) < db::clusterPosition(far,1)) == cellFirst);
+    }
+}
+
+TEST_CASE("string table") {
+    MDB_env *env = db::createMemoryEnv();
+    MDB_txn *txn;
+    REQUIRE(mdb_txn_begin(env,NULL,0,&txn) == 0);
+
+    SECTION("absent") {
+        db::StringTable strings(txn);
+        REQUIRE(strings.empty());
+        REQUIRE(strings.code("highway") == 0);
+    }
+
+    SECTION("codes and strings") {
+        db::StringTable::create(txn,{"highway","residential","name"});
+        db::StringTable strings(txn);
+        REQUIRE(strings.size() == 3);
+        REQUIRE(string(strings.get(2)) == "residential");
+        REQUIRE(strings.code("name") == 3);
+        REQUIRE(strings.code("highway") == 1);
+        REQUIRE(strings.code("building") == 0);
+        REQUIRE(string(strings.get(1)) == "highway");
+    }
+
+    mdb_txn_abort(txn);
+    mdb_env_close(env);
+}
@@ -0,0 +1,73 @@
+#include "catch2/catch_test_macros.hpp"
+#include "osmx/tag_filter.h"
+
+using namespace std;
+using namespace osmx;
+
+TEST_CASE("tag filter parsing") {
+    SECTION("valid expressions") {
+        TagFilter filter;
+        REQUIRE(filter.empty());
+        REQUIRE(filter.add("amenity"));
+        REQUIRE(filter.add("w/highway=primary"));
+        REQUIRE(filter.add("nr/name"));
+        REQUIRE(filter.add("shop="));
+        REQUIRE(!filter.empty());
+    }
+
+    SECTION("malformed expressions") {
+        TagFilter filter;
+        REQUIRE(!filter.add(""));
+        REQUIRE(!filter.add("/amenity"));
+        REQUIRE(!filter.add("x/amenity"));
+        REQUIRE(!filter.add("w/"));
+        REQUIRE(!filter.add("=cafe"));
+        REQUIRE(filter.empty());
+    }
+}
+
+TEST_CASE("tag filter matching") {
+    SECTION("any value") {
+        TagFilter filter;
+        filter.add("amenity");
+        REQUIRE(filter.matches(osmium::item_type::node,"amenity","cafe"));
+        REQUIRE(filter.matches(osmium::item_type::relation,"amenity","school"));
+        REQUIRE(!filter.matches(osmium::item_type::node,"shop","bakery"));
+    }
+
+    SECTION("exact value") {
+        TagFilter filter;
+        filter.add("highway=primary");
+        REQUIRE(filter.matches(osmium::item_type::way,"highway","primary"));
+        REQUIRE(!filter.matches(osmium::item_type::way,"highway","primary_link"));
+        REQUIRE(!filter.matches(osmium::item_type::way,"highway",""));
+    }
+
+    SECTION("empty value") {
+        TagFilter filter;
+        filter.add("name=");
+        REQUIRE(filter.matches(osmium::item_type::node,"name",""));
+        REQUIRE(!filter.matches(osmium::item_type::node,"name","Main Street"));
+    }
+
+    SECTION("types") {
+        TagFilter filter;
+        filter.add("w/highway");
+        filter.add("nr/name=Park");
+        REQUIRE(filter.filters(osmium::item_type::node));
+        REQUIRE(filter.filters(osmium::item_type::way));
+        REQUIRE(filter.filters(osmium::item_type::relation));
+        REQUIRE(filter.matches(osmium::item_type::way,"highway","service"));
+        REQUIRE(!filter.matches(osmium::item_type::node,"highway","crossing"));
+        REQUIRE(!filter.matches(osmium::item_type::way,"name","Park"));
+        REQUIRE(filter.matches(osmium::item_type::relation,"name","Park"));
+    }
+
+    SECTION("type not filtered") {
+        TagFilter filter;
+        filter.add("n/amenity");
+        REQUIRE(filter.filters(osmium::item_type::node));
+        REQUIRE(!filter.filters(osmium::item_type::way));
+        REQUIRE(!filter.filters(osmium::item_type::relation));
+    }
+}